@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Performance regression gate for the aisdiMaps benchmark application.
+
+Runs the benchmark binary, compares every benchmark listed in the baseline
+file with the fresh samples and fails when a benchmark became slower by more
+than the allowed tolerance *and* the slowdown is statistically significant
+(one-sided Mann-Whitney U test), so that ordinary noise does not fail the gate.
+The samples are taken by several processes in turn: heap layout, page placement and
+clock speed differ from one process to the next more than between the repetitions
+within one, and a baseline taken by a single process mistakes that for a change.
+The current samples are also divided by the drift, the median slowdown over all the
+benchmarks, since a machine that is busier or clocked lower than when the baseline was
+recorded slows every benchmark alike. A regression is a benchmark slowing down beyond
+the others, so a change that slows down most benchmarks evenly is not caught.
+
+With --update the baseline file is rewritten from a fresh run instead. It records
+only the gated benchmarks: thread-scaling ones depend on the machine's cores more
+than on the code, so the binary leaves them out of --gated runs.
+"""
+
+import argparse
+import json
+import math
+import subprocess
+import sys
+
+
+def median(samples):
+    ordered = sorted(samples)
+    middle = len(ordered) // 2
+    if len(ordered) % 2 == 0:
+        return (ordered[middle - 1] + ordered[middle]) / 2.0
+    return ordered[middle]
+
+
+def mann_whitney_greater(current, baseline):
+    """P-value of the hypothesis that `current` samples are larger than `baseline`.
+
+    Uses the normal approximation with tie correction, which is accurate enough
+    for the 10+ repetitions the gate runs with.
+    """
+    n1, n2 = len(current), len(baseline)
+    pooled = sorted([(value, 0) for value in current] + [(value, 1) for value in baseline])
+
+    ranks = [0.0] * len(pooled)
+    ties = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        count = j - i + 1
+        ties += count ** 3 - count
+        i = j + 1
+
+    rank_sum = sum(rank for rank, (_, group) in zip(ranks, pooled) if group == 0)
+    u = rank_sum - n1 * (n1 + 1) / 2.0
+    mean = n1 * n2 / 2.0
+    total = n1 + n2
+    variance = n1 * n2 / 12.0 * ((total + 1) - ties / (total * (total - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u - mean - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def drift(baseline, current):
+    """Median over the benchmarks in both runs of the ratio of their median times."""
+    ratios = [median(current[name]) / median(baseline[name])
+              for name in baseline if name in current]
+    return median(ratios) if ratios else 1.0
+
+
+def run_benchmarks(binary, repetitions, processes, size, names):
+    """Runs `processes` instances of the binary one after another and pools their samples."""
+    pooled = None
+    for process in range(processes):
+        share = repetitions // processes + (1 if process < repetitions % processes else 0)
+        if share == 0:
+            continue
+        command = [binary, "--json", "--gated", "--repetitions", str(share)]
+        if size is not None:
+            command += ["--size", str(size)]
+        if names:
+            command += ["--only", ",".join(names)]
+        output = subprocess.run(command, check=True, stdout=subprocess.PIPE,
+                                universal_newlines=True).stdout
+        result = json.loads(output)
+        if pooled is None:
+            pooled = result
+            continue
+        pooled["repetitions"] += result["repetitions"]
+        for name, samples in result["benchmarks"].items():
+            pooled["benchmarks"].setdefault(name, []).extend(samples)
+    return pooled
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--benchmark", required=True, help="path to the aisdiMaps binary")
+    parser.add_argument("--baseline", required=True, help="path to the baseline JSON file")
+    parser.add_argument("--repetitions", type=int, default=15)
+    parser.add_argument("--processes", type=int, default=5,
+                        help="number of processes the repetitions are spread over (default: 5)")
+    parser.add_argument("--tolerance", type=float, default=0.10,
+                        help="allowed relative slowdown of the median (default: 0.10)")
+    parser.add_argument("--alpha", type=float, default=0.01,
+                        help="significance level of the Mann-Whitney test (default: 0.01)")
+    parser.add_argument("--update", action="store_true",
+                        help="rewrite the baseline from a fresh run and exit")
+    args = parser.parse_args()
+
+    if args.update:
+        fresh = run_benchmarks(args.benchmark, args.repetitions, args.processes, None, None)
+        with open(args.baseline, "w") as baseline_file:
+            json.dump(fresh, baseline_file, indent=2, sort_keys=True)
+            baseline_file.write("\n")
+        print("perfcheck: baseline written to %s" % args.baseline)
+        return 0
+
+    with open(args.baseline) as baseline_file:
+        baseline = json.load(baseline_file)
+    current = run_benchmarks(args.benchmark, args.repetitions, args.processes, baseline["size"],
+                             sorted(baseline["benchmarks"]))
+
+    machine = drift(baseline["benchmarks"], current["benchmarks"])
+    print("perfcheck: machine drift %+.1f%%, divided out of the current samples" % (100 * (machine - 1.0)))
+    if abs(machine - 1.0) > 0.25:
+        print("perfcheck: warning: the machine is much busier or idler than when the baseline was"
+              " recorded; cache-bound benchmarks do not slow down in proportion, rerun before"
+              " trusting a failure")
+    regressions = []
+    print("%-28s %12s %12s %9s %9s" % ("benchmark", "baseline", "current", "change", "p-value"))
+    for name in sorted(baseline["benchmarks"]):
+        if name not in current["benchmarks"]:
+            print("%-28s %12s" % (name, "missing"))
+            regressions.append(name)
+            continue
+        old = baseline["benchmarks"][name]
+        new = [sample / machine for sample in current["benchmarks"][name]]
+        change = median(new) / median(old) - 1.0
+        p_value = mann_whitney_greater(new, old)
+        regressed = change > args.tolerance and p_value < args.alpha
+        print("%-28s %12.2f %12.2f %+8.1f%% %9.4f%s"
+              % (name, median(old), median(new), 100 * change, p_value,
+                 "  REGRESSION" if regressed else ""))
+        if regressed:
+            regressions.append(name)
+
+    if regressions:
+        print("perfcheck: %d benchmark(s) regressed: %s" % (len(regressions), ", ".join(regressions)))
+        return 1
+    print("perfcheck: no regressions (tolerance %.0f%%, alpha %.3f)"
+          % (100 * args.tolerance, args.alpha))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,98 @@
+#ifndef AISDI_MAPS_BLOOMFILTER_H
+#define AISDI_MAPS_BLOOMFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "KeyTraits.h"
+
+namespace aisdi
+{
+
+//a split block Bloom filter over 64-bit key hashes: a key picks one block of 256 bits,
+//eight 32-bit words, and sets one bit in each word, so a lookup reads a single cache line
+//and its eight lanes are independent multiplies and masks the compiler can vectorize.
+//At 10 bits per key about 1% of the keys never added are reported as maybe present.
+//Bits can not be cleared, a filter of removed keys has to be rebuilt
+class BloomFilter
+{
+public:
+  using size_type = std::size_t;
+
+private:
+  static const unsigned LANES=8;
+
+  struct alignas(32) Block
+  {
+    std::uint32_t words[LANES];
+  };
+
+  std::vector<Block> blocks;
+  size_type capacity;
+
+public:
+  explicit BloomFilter(size_type expectedKeys=0, unsigned bitsPerKey=10)
+    : blocks((expectedKeys*bitsPerKey+LANES*32-1)/(LANES*32)+1, Block()), capacity(expectedKeys)
+  {}
+
+  void insert(std::uint64_t hash)
+  {
+    const std::uint64_t h=mixBits(hash);
+    Block& block=blocks[blockOf(h)];
+    std::uint32_t masks[LANES];
+    makeMasks(static_cast<std::uint32_t>(h), masks);
+    for (unsigned i=0; i<LANES; ++i)
+        block.words[i]|=masks[i];
+  }
+
+  //false only for hashes never inserted
+  bool mayContain(std::uint64_t hash) const
+  {
+    const std::uint64_t h=mixBits(hash);
+    const Block& block=blocks[blockOf(h)];
+    std::uint32_t masks[LANES];
+    makeMasks(static_cast<std::uint32_t>(h), masks);
+    std::uint32_t missing=0;
+    for (unsigned i=0; i<LANES; ++i)
+        missing|=masks[i] & ~block.words[i];
+    return missing==0;
+  }
+
+  void clear()
+  {
+    for (auto&& block : blocks)
+        block=Block();
+  }
+
+  //the number of keys the filter was sized for; beyond it the false positives rise
+  size_type getCapacity() const
+  {
+    return capacity;
+  }
+
+  size_type getBitCount() const
+  {
+    return blocks.size()*LANES*32;
+  }
+
+private:
+  //the high half of the hash picks the block, by multiplication rather than modulo
+  size_type blockOf(std::uint64_t h) const
+  {
+    return static_cast<size_type>(((h>>32)*blocks.size())>>32);
+  }
+
+  //the low half picks a bit in every word, through a different odd multiplier for each
+  static void makeMasks(std::uint32_t h, std::uint32_t (&masks)[LANES])
+  {
+    static const std::uint32_t SALTS[LANES]={ 0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                              0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+    for (unsigned i=0; i<LANES; ++i)
+        masks[i]=std::uint32_t(1) << ((h*SALTS[i])>>27);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_BLOOMFILTER_H */
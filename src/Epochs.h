@@ -0,0 +1,242 @@
+#ifndef AISDI_MAPS_EPOCHS_H
+#define AISDI_MAPS_EPOCHS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aisdi
+{
+
+//epoch-based reclamation: a thread announces the global epoch while it reads shared nodes and
+//memory retired in epoch e is freed once the global epoch reaches e+2. The epoch advances
+//only when every reading thread has announced the current one, so by then none of them
+//can still hold a pointer obtained before the memory was unlinked.
+//Each thread frees what it retired itself; when a thread exits, what it could not free yet
+//is handed over to the Epochs, freed by the next thread to collect, and its record is taken
+//over by the next new thread, so a pool of short-lived threads leaks nothing
+class Epochs
+{
+public:
+  struct Retired
+  {
+      std::uint64_t epoch;
+      void* pointer;
+      void (*free)(void*);
+  };
+
+  struct ThreadRecords;
+
+  //one per thread using the Epochs, reused after the thread exits, freed with the Epochs
+  struct Record
+  {
+      static const std::uint64_t IDLE=~std::uint64_t(0);
+      std::atomic<std::uint64_t> epoch{IDLE};
+      std::atomic<std::thread::id> owner;//no thread's id while the record is free
+      const Epochs* epochs;
+      ThreadRecords* holder=nullptr;//of the owner, guarded by the registry mutex
+      Record* next=nullptr;
+      unsigned nesting=0;
+      std::vector<Retired> retired;
+      std::size_t collectAt=COLLECT_BATCH;
+
+      Record(const Epochs* pEpochs, std::thread::id pOwner): owner(pOwner), epochs(pEpochs)
+      {}
+  };
+
+  //the records a thread holds in all Epochs, given up when the thread exits
+  struct ThreadRecords
+  {
+      std::vector<Record*> records;
+      std::uint64_t cachedId=0;//the Epochs used last and the thread's record there
+      Record* cachedRecord=nullptr;
+
+      ~ThreadRecords()
+      {
+        std::lock_guard<std::mutex> lock(registry());
+        for (Record* record : records)
+            record->epochs->abandon(*record);
+      }
+  };
+
+  Epochs(): id(nextId().fetch_add(1, std::memory_order_relaxed))
+  {}
+
+  Epochs(const Epochs&) = delete;
+  Epochs& operator=(const Epochs&) = delete;
+
+  ~Epochs()
+  {
+    std::lock_guard<std::mutex> lock(registry());
+    Record* record=records.load(std::memory_order_acquire);
+    while(record!=nullptr){
+        if(record->holder!=nullptr){
+            auto& held=record->holder->records;
+            held.erase(std::find(held.begin(), held.end(), record));
+        }
+        freeAll(record->retired);
+        Record* next=record->next;
+        delete record;
+        record=next;
+    }
+    freeAll(orphans);
+  }
+
+  Record* pin() const
+  {
+    Record* record=recordOfThisThread();
+    if(record->nesting++==0)
+        record->epoch.store(global.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    return record;
+  }
+
+  void unpin(Record* record) const
+  {
+    if(--record->nesting==0)
+        record->epoch.store(Record::IDLE, std::memory_order_release);
+  }
+
+  //the pointer must already be unreachable for threads that pin after this call
+  void retire(Record* record, void* pointer, void (*free)(void*)) const
+  {
+    record->retired.push_back({ global.load(std::memory_order_seq_cst), pointer, free });
+    if(record->retired.size()<record->collectAt)
+        return;
+    tryAdvance();
+    const std::uint64_t safe=global.load(std::memory_order_seq_cst);
+    collect(record->retired, safe);
+    record->collectAt=record->retired.size()+COLLECT_BATCH;
+    if(orphanCount.load(std::memory_order_relaxed)!=0){
+        std::lock_guard<std::mutex> lock(orphansMutex);
+        collect(orphans, safe);
+        orphanCount.store(orphans.size(), std::memory_order_relaxed);
+    }
+  }
+
+  //items retired by threads that have exited and not freed yet
+  std::size_t getOrphanCount() const
+  {
+    return orphanCount.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr std::size_t COLLECT_BATCH=64;
+
+  const std::uint64_t id;//tells the Epochs apart in the per-thread cache
+  mutable std::atomic<std::uint64_t> global{0};
+  mutable std::atomic<Record*> records{nullptr};
+  mutable std::mutex orphansMutex;
+  mutable std::vector<Retired> orphans;
+  mutable std::atomic<std::size_t> orphanCount{0};
+
+  static std::atomic<std::uint64_t>& nextId()
+  {
+    static std::atomic<std::uint64_t> counter(1);
+    return counter;
+  }
+
+  //guards the links between records and the threads holding them; taken only when a
+  //thread first uses an Epochs, when it exits and when an Epochs is destroyed. Never
+  //destroyed, as Epochs of static maps may outlive it otherwise
+  static std::mutex& registry()
+  {
+    static std::mutex* mutex=new std::mutex;
+    return *mutex;
+  }
+
+  static ThreadRecords& threadRecords()
+  {
+    static thread_local ThreadRecords records;
+    return records;
+  }
+
+  static void collect(std::vector<Retired>& retired, std::uint64_t safe)
+  {
+    std::size_t kept=0;
+    for (auto&& item : retired) {
+        if(item.epoch+2<=safe)
+            item.free(item.pointer);
+        else
+            retired[kept++]=item;
+    }
+    retired.resize(kept);
+  }
+
+  static void freeAll(const std::vector<Retired>& retired)
+  {
+    for (auto&& item : retired)
+        item.free(item.pointer);
+  }
+
+  void tryAdvance() const
+  {
+    std::uint64_t current=global.load(std::memory_order_seq_cst);
+    for (Record* record=records.load(std::memory_order_acquire); record!=nullptr; record=record->next) {
+        const std::uint64_t announced=record->epoch.load(std::memory_order_seq_cst);
+        if(announced!=Record::IDLE && announced!=current)
+            return;
+    }
+    global.compare_exchange_strong(current, current+1, std::memory_order_seq_cst);
+  }
+
+  //the thread of record has exited, with nothing pinned; called under the registry mutex
+  void abandon(Record& record) const
+  {
+    {
+        std::lock_guard<std::mutex> lock(orphansMutex);
+        orphans.insert(orphans.end(), record.retired.begin(), record.retired.end());
+        orphanCount.store(orphans.size(), std::memory_order_relaxed);
+    }
+    record.retired.clear();
+    record.retired.shrink_to_fit();
+    record.collectAt=COLLECT_BATCH;
+    record.holder=nullptr;
+    record.owner.store(std::thread::id(), std::memory_order_release);
+  }
+
+  Record* recordOfThisThread() const
+  {
+    ThreadRecords& mine=threadRecords();
+    if(mine.cachedId==id)
+        return mine.cachedRecord;
+    const std::thread::id self=std::this_thread::get_id();
+    Record* record=records.load(std::memory_order_acquire);
+    while(record!=nullptr && record->owner.load(std::memory_order_acquire)!=self)
+        record=record->next;
+    if(record==nullptr){
+        record=takeFreeRecord(self);
+        if(record==nullptr){
+            record=new Record(this, self);
+            Record* first=records.load(std::memory_order_relaxed);
+            do
+                record->next=first;
+            while(!records.compare_exchange_weak(first, record, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        }
+        std::lock_guard<std::mutex> lock(registry());
+        record->holder=&mine;
+        mine.records.push_back(record);
+    }
+    mine.cachedId=id;
+    mine.cachedRecord=record;
+    return record;
+  }
+
+  Record* takeFreeRecord(std::thread::id self) const
+  {
+    for (Record* record=records.load(std::memory_order_acquire); record!=nullptr; record=record->next) {
+        std::thread::id none;
+        if(record->owner.compare_exchange_strong(none, self, std::memory_order_acq_rel))
+            return record;
+    }
+    return nullptr;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_EPOCHS_H */
@@ -0,0 +1,245 @@
+#ifndef AISDI_MAPS_FILTEREDMAP_H
+#define AISDI_MAPS_FILTEREDMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+
+#include "BloomFilter.h"
+#include "HashMap.h"
+#include "KeyTraits.h"
+#include "TreeMap.h"
+
+namespace aisdi
+{
+
+//how the filter of a FilteredMap did: of the lookups of missing keys, the filter answered
+//filtered itself and let falsePositives through to the map
+struct FilterStats
+{
+  std::uint64_t lookups=0;
+  std::uint64_t filtered=0;
+  std::uint64_t falsePositives=0;
+
+  double falsePositiveRate() const
+  {
+    const std::uint64_t misses=filtered+falsePositives;
+    return misses==0 ? 0.0 : static_cast<double>(falsePositives)/misses;
+  }
+};
+
+//a Map (a TreeMap or a HashMap) with a Bloom filter of its keys in front, so that a lookup
+//of a missing key usually costs one hash and one cache line instead of a walk down the
+//tree or along a chain. Removed keys stay in the filter until it is rebuilt, which happens
+//when the keys and the removed keys together outgrow its capacity; a rebuild sizes it for
+//twice the items, so it is amortized O(1) per update. Lookups count into the stats even
+//when const, so a map must not be read by several threads at once
+template <typename Map, typename Hash = DefaultHash<typename Map::key_type>>
+class FilteredMap
+{
+public:
+  using key_type = typename Map::key_type;
+  using mapped_type = typename Map::mapped_type;
+  using value_type = typename Map::value_type;
+  using size_type = std::size_t;
+  using reference = typename Map::reference;
+  using const_reference = typename Map::const_reference;
+  using map_type = Map;
+
+  using iterator = typename Map::iterator;
+  using const_iterator = typename Map::const_iterator;
+
+private:
+  static constexpr size_type MIN_CAPACITY=64;
+
+  Map map;
+  BloomFilter filter;
+  size_type stale=0;//removed keys still in the filter
+  Hash hashKey;
+  mutable FilterStats stats;
+
+public:
+  FilteredMap(): filter(MIN_CAPACITY)
+  {}
+
+  FilteredMap(std::initializer_list<value_type> list): map(list), filter(MIN_CAPACITY)
+  {
+    rebuild();
+  }
+
+  //puts a filter in front of a map already filled
+  explicit FilteredMap(Map pMap): map(std::move(pMap)), filter(MIN_CAPACITY)
+  {
+    rebuild();
+  }
+
+  //for repeated keys the last value wins
+  template <typename InputIt>
+  FilteredMap(InputIt first, InputIt last): filter(MIN_CAPACITY)
+  {
+    for (; first!=last; ++first)
+        map[first->first]=first->second;
+    rebuild();
+  }
+
+  bool isEmpty() const
+  {
+    return map.isEmpty();
+  }
+
+  size_type getSize() const
+  {
+    return map.getSize();
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    const size_type size=map.getSize();
+    mapped_type& value=map[key];
+    if(map.getSize()!=size){
+        filter.insert(hashKey(key));
+        rebuildIfFull();
+    }
+    return value;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    const auto it=find(key);
+    if (it == end())
+        throw std::out_of_range("Key does not exists");
+    return it->second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    const iterator it=find(key);
+    if (it == end())
+        throw std::out_of_range("Key does not exists");
+    return it->second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    ++stats.lookups;
+    if(!filter.mayContain(hashKey(key))){
+        ++stats.filtered;
+        return map.end();
+    }
+    const_iterator it=map.find(key);
+    if(it==map.end())
+        ++stats.falsePositives;
+    return it;
+  }
+
+  iterator find(const key_type& key)
+  {
+    ++stats.lookups;
+    if(!filter.mayContain(hashKey(key))){
+        ++stats.filtered;
+        return map.end();
+    }
+    iterator it=map.find(key);
+    if(it==map.end())
+        ++stats.falsePositives;
+    return it;
+  }
+
+  void remove(const key_type& key)
+  {
+    if(!filter.mayContain(hashKey(key)))
+        throw std::out_of_range("can not remove key that not exist in tree");
+    map.remove(key);
+    ++stale;
+    rebuildIfFull();
+  }
+
+  //returns the iterator following the removed item
+  iterator remove(const const_iterator& it)
+  {
+    iterator next=map.remove(it);
+    ++stale;
+    rebuildIfFull();
+    return next;
+  }
+
+  //refills the filter from the keys in the map, forgetting the removed ones: O(n)
+  void rebuild()
+  {
+    BloomFilter rebuilt(std::max<size_type>(2*map.getSize(), MIN_CAPACITY));
+    for (auto&& item : map)
+        rebuilt.insert(hashKey(item.first));
+    filter=std::move(rebuilt);
+    stale=0;
+  }
+
+  const FilterStats& getStats() const
+  {
+    return stats;
+  }
+
+  void resetStats()
+  {
+    stats=FilterStats();
+  }
+
+  bool operator==(const FilteredMap& other) const
+  {
+    return map==other.map;
+  }
+
+  bool operator!=(const FilteredMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return map.begin();
+  }
+
+  iterator end()
+  {
+    return map.end();
+  }
+
+  const_iterator cbegin() const
+  {
+    return map.cbegin();
+  }
+
+  const_iterator cend() const
+  {
+    return map.cend();
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+
+private:
+  void rebuildIfFull()
+  {
+    if(map.getSize()+stale>filter.getCapacity())
+        rebuild();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+using FilteredTreeMap = FilteredMap<TreeMap<KeyType, ValueType>>;
+
+template <typename KeyType, typename ValueType>
+using FilteredHashMap = FilteredMap<HashMap<KeyType, ValueType>>;
+
+}
+
+#endif /* AISDI_MAPS_FILTEREDMAP_H */
@@ -0,0 +1,436 @@
+#ifndef AISDI_MAPS_FLATMAP_H
+#define AISDI_MAPS_FLATMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "KeyTraits.h"
+
+namespace aisdi
+{
+
+//an ordered map in two sorted parallel arrays, one of keys and one of values, so lookups
+//binary search a dense array of keys only and scans are sequential. New keys go to a small
+//unsorted buffer that is sorted and merged into the arrays once it holds more than sqrt(n)
+//items, which makes an insert O(sqrt(n)) amortized instead of O(n). Lookups check the
+//arrays, then the buffer. Whatever hands out iterators merges the buffer first, also when
+//const, so a map with buffered items must not be read by several threads at once; flush()
+//makes it safe to share
+template <typename KeyType, typename ValueType, typename Compare = DefaultCompare<KeyType>>
+class FlatMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using key_compare = Compare;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  //items are not stored as pairs, iterators yield pairs of references instead
+  using reference = std::pair<const key_type&, mapped_type&>;
+  using const_reference = std::pair<const key_type&, const mapped_type&>;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  mutable std::vector<key_type> keys;//sorted
+  mutable std::vector<mapped_type> values;
+  mutable std::vector<key_type> bufferKeys;//unsorted, none of them in keys
+  mutable std::vector<mapped_type> bufferValues;
+  Compare compare;//keys are equal when neither is less than the other
+
+public:
+  FlatMap()
+  {}
+
+  explicit FlatMap(const Compare& pCompare): compare(pCompare)
+  {}
+
+  FlatMap(std::initializer_list<value_type> list, const Compare& pCompare=Compare())
+    : FlatMap(list.begin(), list.end(), pCompare)
+  {}
+
+  //sorts the input once: O(n log n); for repeated keys the last value wins
+  template <typename InputIt>
+  FlatMap(InputIt first, InputIt last, const Compare& pCompare=Compare()): compare(pCompare)
+  {
+    for (; first!=last; ++first){
+        bufferKeys.push_back(first->first);
+        bufferValues.push_back(first->second);
+    }
+    flush();
+  }
+
+  bool isEmpty() const
+  {
+    return getSize()==0;
+  }
+
+  size_type getSize() const
+  {
+    return keys.size()+bufferKeys.size();
+  }
+
+  key_compare key_comp() const
+  {
+    return compare;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    const size_type index=lowerBound(key);
+    if(index<keys.size() && !compare(key, keys[index]))
+        return values[index];
+    const size_type buffered=findBuffered(key);
+    if(buffered<bufferKeys.size())
+        return bufferValues[buffered];
+    bufferKeys.push_back(key);
+    try{
+        bufferValues.emplace_back();
+    }
+    catch(...){
+        bufferKeys.pop_back();
+        throw;
+    }
+    if(bufferKeys.size()*bufferKeys.size()<=keys.size())
+        return bufferValues.back();
+    flush();
+    return values[lowerBound(key)];
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    const mapped_type* value=findValue(key);
+    if (value == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return *value;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return const_cast<mapped_type&>(static_cast<const FlatMap*>(this)->valueOf(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    flush();
+    const size_type index=lowerBound(key);
+    return ConstIterator(*this, index<keys.size() && !compare(key, keys[index]) ? index : keys.size());
+  }
+
+  iterator find(const key_type& key)
+  {
+    return Iterator(static_cast<const FlatMap*>(this)->find(key));
+  }
+
+  //the first item with a key not smaller than key
+  const_iterator lower_bound(const key_type& key) const
+  {
+    flush();
+    return ConstIterator(*this, lowerBound(key));
+  }
+
+  iterator lower_bound(const key_type& key)
+  {
+    return Iterator(static_cast<const FlatMap*>(this)->lower_bound(key));
+  }
+
+  void remove(const key_type& key)
+  {
+    const size_type index=lowerBound(key);
+    if(index<keys.size() && !compare(key, keys[index])){
+        eraseAt(index);
+        return;
+    }
+    const size_type buffered=findBuffered(key);
+    if(buffered==bufferKeys.size())
+        throw std::out_of_range("can not remove key that not exist in tree");
+    //the buffer is unordered, the last item can fill the gap
+    bufferKeys[buffered]=std::move(bufferKeys.back());
+    bufferValues[buffered]=std::move(bufferValues.back());
+    bufferKeys.pop_back();
+    bufferValues.pop_back();
+  }
+
+  //returns the iterator following the removed item
+  iterator remove(const const_iterator& it)
+  {
+    if (it == end())
+        throw std::out_of_range("Can not remove the end");
+    eraseAt(it.index);
+    return Iterator(ConstIterator(*this, it.index));
+  }
+
+  //sorts the buffered items into the arrays: O(n + m log m) for m buffered items
+  void flush() const
+  {
+    if(bufferKeys.empty())
+        return;
+    std::vector<size_type> order(bufferKeys.size());
+    for (size_type i=0; i<order.size(); ++i)
+        order[i]=i;
+    //stable, so that of repeated keys, which only the constructor adds, the last one wins
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_type a, size_type b) { return compare(bufferKeys[a], bufferKeys[b]); });
+
+    std::vector<key_type> mergedKeys;
+    std::vector<mapped_type> mergedValues;
+    mergedKeys.reserve(keys.size()+order.size());
+    mergedValues.reserve(keys.size()+order.size());
+    size_type i=0;
+    for (size_type j=0; j<order.size(); ++j){
+        const size_type b=order[j];
+        if(j+1<order.size() && !compare(bufferKeys[b], bufferKeys[order[j+1]]))
+            continue;
+        for (; i<keys.size() && compare(keys[i], bufferKeys[b]); ++i){
+            mergedKeys.push_back(std::move(keys[i]));
+            mergedValues.push_back(std::move(values[i]));
+        }
+        mergedKeys.push_back(std::move(bufferKeys[b]));
+        mergedValues.push_back(std::move(bufferValues[b]));
+    }
+    for (; i<keys.size(); ++i){
+        mergedKeys.push_back(std::move(keys[i]));
+        mergedValues.push_back(std::move(values[i]));
+    }
+    keys.swap(mergedKeys);
+    values.swap(mergedValues);
+    bufferKeys.clear();
+    bufferValues.clear();
+  }
+
+  bool operator==(const FlatMap& other) const
+  {
+    if(getSize()!=other.getSize())
+        return false;
+    flush();
+    other.flush();
+    //keys are equal when neither is less than the other, as everywhere else
+    for (size_type i=0; i<keys.size(); ++i)
+        if(compare(keys[i], other.keys[i]) || compare(other.keys[i], keys[i]) || values[i]!=other.values[i])
+            return false;
+    return true;
+  }
+
+  bool operator!=(const FlatMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return Iterator(cbegin());
+  }
+
+  iterator end()
+  {
+    return Iterator(cend());
+  }
+
+  const_iterator cbegin() const
+  {
+    flush();
+    return ConstIterator(*this, 0);
+  }
+
+  const_iterator cend() const
+  {
+    flush();
+    return ConstIterator(*this, keys.size());
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+
+private:
+  //the first index whose key is not smaller than key; the halving step is a conditional
+  //move rather than a branch, so mispredictions do not stall the search
+  size_type lowerBound(const key_type& key) const
+  {
+    size_type length=keys.size();
+    if(length==0)
+        return 0;
+    const key_type* base=keys.data();
+    while(length>1){
+        const size_type half=length/2;
+        base=compare(base[half-1], key) ? base+half : base;
+        length-=half;
+    }
+    return static_cast<size_type>(base-keys.data())+(compare(*base, key) ? 1 : 0);
+  }
+
+  size_type findBuffered(const key_type& key) const
+  {
+    size_type i=0;
+    while(i<bufferKeys.size() && (compare(bufferKeys[i], key) || compare(key, bufferKeys[i])))
+        ++i;
+    return i;
+  }
+
+  const mapped_type* findValue(const key_type& key) const
+  {
+    const size_type index=lowerBound(key);
+    if(index<keys.size() && !compare(key, keys[index]))
+        return &values[index];
+    const size_type buffered=findBuffered(key);
+    return buffered<bufferKeys.size() ? &bufferValues[buffered] : nullptr;
+  }
+
+  void eraseAt(size_type index)
+  {
+    keys.erase(keys.begin()+index);
+    values.erase(values.begin()+index);
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class FlatMap<KeyType, ValueType, Compare>::ConstIterator
+{
+    friend class FlatMap;
+protected:
+    const FlatMap* map;
+    size_type index;
+
+    explicit ConstIterator(const FlatMap& pMap, size_type pIndex): map(&pMap), index(pIndex)
+    {}
+
+    //operator-> has to return something that holds the pair of references
+    template <typename Reference>
+    struct Arrow
+    {
+        Reference item;
+
+        const Reference* operator->() const
+        {
+            return &item;
+        }
+    };
+
+public:
+  using reference = typename FlatMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename FlatMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = Arrow<reference>;
+
+  ConstIterator& operator++()
+  {
+    if(index==map->keys.size())
+        throw std::out_of_range("can not increment the end");
+    ++index;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(map->isEmpty())
+        throw std::out_of_range("can not decrement iterator of empty collection");
+    if(index==0)
+        throw std::out_of_range("can not decrement begin");
+    --index;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(index==map->keys.size())
+        throw std::out_of_range("can not refer iterator of end");
+    return reference(map->keys[index], map->values[index]);
+  }
+
+  pointer operator->() const
+  {
+    return pointer{ operator*() };
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return index==other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class FlatMap<KeyType, ValueType, Compare>::Iterator : public FlatMap<KeyType, ValueType, Compare>::ConstIterator
+{
+public:
+  using reference = typename FlatMap::reference;
+  using pointer = typename ConstIterator::template Arrow<reference>;
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  reference operator*() const
+  {
+    const auto item=ConstIterator::operator*();
+    return reference(item.first, const_cast<mapped_type&>(item.second));
+  }
+
+  pointer operator->() const
+  {
+    return pointer{ operator*() };
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_FLATMAP_H */
@@ -0,0 +1,364 @@
+#ifndef AISDI_MAPS_FROZENMAP_H
+#define AISDI_MAPS_FROZENMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "HashMap.h"
+#include "KeyTraits.h"
+
+namespace aisdi
+{
+
+//an immutable map built once from a range of items, e.g. by freeze() of a HashMap, whose
+//lookups take exactly one probe. Keys and values lie in two arrays of the size of the map,
+//placed by a minimal perfect hash in the manner of CHD: the hash of a key picks a bucket
+//of about four keys and the bucket's pilot, a seed found at build time so that its keys
+//land on free slots, picks the slot. A bucket of a single key stores its slot in the pilot
+//directly. Besides the arrays the map costs a 32-bit pilot per bucket, about one byte per
+//item. Missing keys hash to some slot too and are told apart by comparing the key there.
+//Items are iterated in slot order. Distinct keys of the same hash can not be placed apart
+template <typename KeyType, typename ValueType, typename Hash = DefaultHash<KeyType>,
+          typename KeyEqual = DefaultKeyEqual<KeyType>>
+class FrozenMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  //items are not stored as pairs, iterators yield pairs of references instead
+  using const_reference = std::pair<const key_type&, const mapped_type&>;
+  using reference = const_reference;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static constexpr std::uint32_t DIRECT=std::uint32_t(1) << 31;//the pilot is the slot itself
+  static constexpr size_type KEYS_PER_BUCKET=4;
+
+  std::vector<key_type> keys;
+  std::vector<mapped_type> values;
+  std::vector<std::uint32_t> pilots;
+  Hash hashKey;
+  KeyEqual equalKeys;
+
+public:
+  FrozenMap()
+  {}
+
+  FrozenMap(std::initializer_list<value_type> list, const Hash& pHash=Hash(), const KeyEqual& pEqual=KeyEqual())
+    : FrozenMap(list.begin(), list.end(), pHash, pEqual)
+  {}
+
+  //builds the map in expected O(n); for repeated keys the last value wins, distinct keys
+  //of equal hashes, or of hashes that no pilot places apart, throw std::invalid_argument
+  template <typename InputIt>
+  FrozenMap(InputIt first, InputIt last, const Hash& pHash=Hash(), const KeyEqual& pEqual=KeyEqual())
+    : hashKey(pHash), equalKeys(pEqual)
+  {
+    std::vector<key_type> itemKeys;
+    std::vector<mapped_type> itemValues;
+    for (; first!=last; ++first){
+        itemKeys.push_back(first->first);
+        itemValues.push_back(first->second);
+    }
+    build(itemKeys, itemValues);
+  }
+
+  bool isEmpty() const
+  {
+    return keys.empty();
+  }
+
+  size_type getSize() const
+  {
+    return keys.size();
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    const size_type slot=slotOf(key);
+    if (slot == keys.size())
+        throw std::out_of_range("Key does not exists");
+    return values[slot];
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return ConstIterator(*this, slotOf(key));
+  }
+
+  //equal maps may place their items differently, so each key is looked up in the other
+  bool operator==(const FrozenMap& other) const
+  {
+    if(keys.size()!=other.keys.size())
+        return false;
+    for (size_type i=0; i<keys.size(); ++i){
+        const size_type slot=other.slotOf(keys[i]);
+        if(slot==other.keys.size() || values[i]!=other.values[slot])
+            return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const FrozenMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator(*this, 0);
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(*this, keys.size());
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+
+private:
+  //maps the high half of x onto [0, range) by multiplication rather than modulo
+  static size_type scale(std::uint64_t x, size_type range)
+  {
+    return static_cast<size_type>(((x>>32)*range)>>32);
+  }
+
+  std::uint64_t hashOf(const key_type& key) const
+  {
+    return mixBits(hashKey(key));
+  }
+
+  size_type bucketOf(std::uint64_t hash) const
+  {
+    return scale(hash, pilots.size());
+  }
+
+  static size_type place(std::uint64_t hash, std::uint32_t pilot, size_type slots)
+  {
+    return scale(mixBits(hash+pilot*0x9e3779b97f4a7c15ULL), slots);
+  }
+
+  //the slot of key, or the size of the map if there is no such key
+  size_type slotOf(const key_type& key) const
+  {
+    if(keys.empty())
+        return 0;
+    const std::uint64_t hash=hashOf(key);
+    const std::uint32_t pilot=pilots[bucketOf(hash)];
+    const size_type slot=(pilot & DIRECT)!=0 ? pilot & ~DIRECT : place(hash, pilot, keys.size());
+    return equalKeys(keys[slot], key) ? slot : keys.size();
+  }
+
+  void build(std::vector<key_type>& itemKeys, std::vector<mapped_type>& itemValues)
+  {
+    if(itemKeys.size()>=DIRECT)
+        throw std::length_error("too many items to freeze");
+    if(itemKeys.empty())
+        return;
+    pilots.assign(itemKeys.size()/KEYS_PER_BUCKET+1, 0);
+    std::vector<std::uint64_t> hashes(itemKeys.size());
+    for (size_type i=0; i<itemKeys.size(); ++i)
+        hashes[i]=hashOf(itemKeys[i]);
+
+    //the items of each bucket, bucket after bucket, by a counting sort
+    std::vector<size_type> bucketStart(pilots.size()+1, 0);
+    for (auto hash : hashes)
+        ++bucketStart[bucketOf(hash)+1];
+    for (size_type b=0; b<pilots.size(); ++b)
+        bucketStart[b+1]+=bucketStart[b];
+    std::vector<size_type> items(itemKeys.size());
+    {
+        std::vector<size_type> next(bucketStart.begin(), bucketStart.end()-1);
+        for (size_type i=0; i<itemKeys.size(); ++i)
+            items[next[bucketOf(hashes[i])]++]=i;
+    }
+
+    //a repeated key is in the same bucket as its first occurrence; the later one, kept
+    //in input order by the sort, wins
+    std::vector<size_type> bucketSize(pilots.size());
+    size_type count=0;
+    for (size_type b=0; b<pilots.size(); ++b){
+        const size_type begin=bucketStart[b];
+        size_type end=begin;
+        for (size_type j=begin; j<bucketStart[b+1]; ++j){
+            const size_type item=items[j];
+            size_type k=begin;
+            while(k<end && !equalKeys(itemKeys[items[k]], itemKeys[item])){
+                if(hashes[items[k]]==hashes[item])
+                    throw std::invalid_argument("can not freeze distinct keys of equal hashes");
+                ++k;
+            }
+            items[k]=item;
+            if(k==end)
+                ++end;
+        }
+        bucketSize[b]=end-begin;
+        count+=end-begin;
+    }
+
+    //larger buckets are harder to place and go first, while most slots are free
+    std::vector<size_type> order(pilots.size());
+    for (size_type b=0; b<order.size(); ++b)
+        order[b]=b;
+    std::stable_sort(order.begin(), order.end(),
+                     [&bucketSize](size_type a, size_type b) { return bucketSize[a]>bucketSize[b]; });
+
+    std::vector<size_type> itemAt(count, itemKeys.size());//itemKeys.size() marks a free slot
+    std::vector<size_type> placed;
+    size_type nextFree=0;
+    for (auto b : order){
+        if(bucketSize[b]==0)
+            break;//so are all the buckets after it
+        const size_type* bucket=items.data()+bucketStart[b];
+        if(bucketSize[b]==1){
+            while(itemAt[nextFree]!=itemKeys.size())
+                ++nextFree;
+            itemAt[nextFree]=bucket[0];
+            pilots[b]=DIRECT | static_cast<std::uint32_t>(nextFree);
+            continue;
+        }
+        //the pilots run out only if keys of different 64-bit hashes keep colliding
+        std::uint32_t pilot=0;
+        for (; pilot<DIRECT; ++pilot){
+            placed.clear();
+            for (size_type j=0; j<bucketSize[b]; ++j){
+                const size_type slot=place(hashes[bucket[j]], pilot, count);
+                if(itemAt[slot]!=itemKeys.size())
+                    break;
+                itemAt[slot]=bucket[j];
+                placed.push_back(slot);
+            }
+            if(placed.size()==bucketSize[b]){
+                pilots[b]=pilot;
+                break;
+            }
+            for (auto slot : placed)
+                itemAt[slot]=itemKeys.size();
+        }
+        if(pilot==DIRECT)
+            throw std::invalid_argument("can not place the keys of a bucket, their hashes collide");
+    }
+
+    keys.reserve(count);
+    values.reserve(count);
+    for (auto item : itemAt){
+        keys.push_back(std::move(itemKeys[item]));
+        values.push_back(std::move(itemValues[item]));
+    }
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+class FrozenMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator
+{
+    friend class FrozenMap;
+    const FrozenMap* map;
+    size_type index;
+
+    explicit ConstIterator(const FrozenMap& pMap, size_type pIndex): map(&pMap), index(pIndex)
+    {}
+
+    //operator-> has to return something that holds the pair of references
+    struct Arrow
+    {
+        const_reference item;
+
+        const const_reference* operator->() const
+        {
+            return &item;
+        }
+    };
+
+public:
+  using reference = typename FrozenMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename FrozenMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = Arrow;
+
+  ConstIterator& operator++()
+  {
+    if(index==map->keys.size())
+        throw std::out_of_range("can not increment the end");
+    ++index;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(map->isEmpty())
+        throw std::out_of_range("can not decrement iterator of empty collection");
+    if(index==0)
+        throw std::out_of_range("can not decrement begin");
+    --index;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(index==map->keys.size())
+        throw std::out_of_range("can not refer iterator of end");
+    return reference(map->keys[index], map->values[index]);
+  }
+
+  pointer operator->() const
+  {
+    return pointer{ operator*() };
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return index==other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+//an immutable copy of map whose lookups take one probe: O(n)
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+FrozenMap<KeyType, ValueType, Hash, KeyEqual> freeze(const HashMap<KeyType, ValueType, Hash, KeyEqual>& map)
+{
+  return FrozenMap<KeyType, ValueType, Hash, KeyEqual>(map.begin(), map.end(), map.hash_function(), map.key_eq());
+}
+
+}
+
+#endif /* AISDI_MAPS_FROZENMAP_H */
@@ -1,20 +1,28 @@
 #ifndef AISDI_MAPS_HASHMAP_H
 #define AISDI_MAPS_HASHMAP_H
 
+#include <atomic>
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 
+#include "KeyTraits.h"
+
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
+template <typename KeyType, typename ValueType, typename Hash = DefaultHash<KeyType>,
+          typename KeyEqual = DefaultKeyEqual<KeyType>>
 class HashMap
 {
 public:
   using key_type = KeyType;
   using mapped_type = ValueType;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
   using value_type = std::pair<const key_type, mapped_type>;
   using size_type = std::size_t;
   using reference = value_type&;
@@ -27,17 +35,23 @@ public:
   class Node;
 
 private:
-    int size;
-    int bucketCount;
+    size_type size;
+    size_type bucketCount;
+    size_t fingerprint;//order-independent checksum of the keys, maintained on insert/remove
     Node**tab;
+    //owners[i] counts the maps sharing chain i: a snapshot shares the chains with its map
+    //and either clones a chain only when it first modifies it, so a snapshot costs
+    //O(bucketCount), not O(size)
+    std::atomic<size_type>**owners;
+    Hash hashKey;
+    KeyEqual equalKeys;
     static const int BUCKETINIT=101;
 
 public:
-  HashMap(int pBucketCount = BUCKETINIT) : size(0), bucketCount(pBucketCount)
+  HashMap(size_type pBucketCount = BUCKETINIT) : size(0), bucketCount(pBucketCount), fingerprint(0)
   {
     tab = new Node*[bucketCount]();
-    for(size_t i=0; i<bucketCount; ++i)
-        tab[i]=nullptr;
+    owners = new std::atomic<size_type>*[bucketCount]();
   }
 
   HashMap(std::initializer_list<value_type> list):HashMap()
@@ -46,36 +60,65 @@ public:
         insert(item.first, item.second);
   }
 
-  HashMap(const HashMap& other):HashMap(other.bucketCount)
-  {
-    for(auto&& item :other)
-        insert(item.first, item.second);
-  }
+  //a deep copy, O(n); references and iterators into other stay its own
+  HashMap(const HashMap& other):HashMap(other.bucketCount)
+  {
+    hashKey=other.hashKey;
+    equalKeys=other.equalKeys;
+    shareChainsOf(other);
+    for(size_type i=0; i<bucketCount; ++i)
+        if(tab[i]!=nullptr)
+            ownBucket(i);
+  }
+
+  //an O(bucketCount) copy sharing the chains with this map until either of them modifies
+  //one, which then clones that chain for itself: a consistent view for readers while the
+  //map goes on changing. References and iterators into this map obtained before the
+  //snapshot, or before the first modification of their chain after it, still point into
+  //the shared chain afterwards; writing through them, or passing them to remove or erase,
+  //would change the snapshot, so they have to be obtained again
+  HashMap snapshot() const
+  {
+    HashMap result(bucketCount);
+    result.hashKey=hashKey;
+    result.equalKeys=equalKeys;
+    result.shareChainsOf(*this);
+    return result;
+  }
 
-  HashMap(HashMap&& other):HashMap(other.bucketCount)
+  HashMap(HashMap&& other):HashMap(other.bucketCount)
   {
+    hashKey=other.hashKey;
+    equalKeys=other.equalKeys;
     std::swap(size, other.size);
-    std::swap(tab, other.tab);
-  }
-
-  HashMap& operator=(const HashMap& other)
+    std::swap(fingerprint, other.fingerprint);
+    std::swap(tab, other.tab);
+    std::swap(owners, other.owners);
+  }
+
+  HashMap& operator=(const HashMap& other)
   {
-    if(*this==other)
-        return *this;
-    deleteElementsOfHashMap();
-    for(auto&& item :other)
-        insert(item.first, item.second);
-    return *this;
-  }
+    if(this==&other)
+        return *this;
+    HashMap copy(other);
+    return *this=std::move(copy);
+  }
 
-  HashMap& operator=(HashMap&& other)
+  HashMap& operator=(HashMap&& other)
   {
-    if(*this==other)
+    if(this==&other)
         return *this;
+    deleteElementsOfHashMap();
+    hashKey=other.hashKey;
+    equalKeys=other.equalKeys;
     std::swap(tab, other.tab);
+    std::swap(owners, other.owners);
     std::swap(bucketCount, other.bucketCount);
     size= other.size;
-    other.size=0;
+    other.size=0;
+    fingerprint= other.fingerprint;
+    other.fingerprint=0;
+    return *this;
   }
 
   bool isEmpty() const
@@ -83,12 +126,63 @@ public:
     return (size==0);
   }
 
-  mapped_type& operator[](const key_type& key)
+  mapped_type& operator[](const key_type& key)
   {
-    Node*node=findNode(key);
+    const size_t fullHash=hashKey(key);
+    Node*node=findForWrite(fullHash % bucketCount, key);
     if(node==nullptr)
-        node=insert(key);
-    return node->pair.second;
+        node=insertHashed(fullHash, key, ValueType());
+    return node->pair.second;
+  }
+
+  //calls fn(value) on the value of key, or inserts init if key is missing;
+  //the key is hashed and its bucket walked only once
+  template <typename F>
+  mapped_type& upsert(const key_type& key, const mapped_type& init, F fn)
+  {
+    const size_t fullHash=hashKey(key);
+    Node*node=findForWrite(fullHash % bucketCount, key);
+    if(node==nullptr)
+        return insertHashed(fullHash, key, init)->pair.second;
+    fn(node->pair.second);
+    return node->pair.second;
+  }
+
+  //stores combiner(old value, value) for an existing key, value otherwise
+  template <typename Combiner>
+  mapped_type& mergeValue(const key_type& key, const mapped_type& value, Combiner combiner)
+  {
+    const size_t fullHash=hashKey(key);
+    Node*node=findForWrite(fullHash % bucketCount, key);
+    if(node==nullptr)
+        return insertHashed(fullHash, key, value)->pair.second;
+    node->pair.second=combiner(std::move(node->pair.second), value);
+    return node->pair.second;
+  }
+
+  //mergeValue of every (key, value) item of a forward range; items are hashed in batches
+  //and the head nodes of their chains prefetched ahead of the lookups, so the cache misses
+  //overlap (the bucket array itself is small and stays cached)
+  template <typename ForwardIt, typename Combiner>
+  void upsertMany(ForwardIt first, ForwardIt last, Combiner combiner)
+  {
+    const size_type BATCH=16;
+    size_t hashes[BATCH];
+    while(first!=last){
+        ForwardIt batchEnd=first;
+        size_type count=0;
+        for(; batchEnd!=last && count<BATCH; ++batchEnd, ++count){
+            hashes[count]=hashKey(batchEnd->first);
+            prefetch(tab[hashes[count] % bucketCount]);
+        }
+        for(size_type i=0; i<count; ++i, ++first){
+            Node*node=findForWrite(hashes[i] % bucketCount, first->first);
+            if(node==nullptr)
+                insertHashed(hashes[i], first->first, first->second);
+            else
+                node->pair.second=combiner(std::move(node->pair.second), first->second);
+        }
+    }
   }
 
   const mapped_type& valueOf(const key_type& key) const
@@ -101,7 +195,7 @@ public:
 
   mapped_type& valueOf(const key_type& key)
   {
-    Node* node = findNode(key);
+    Node* node = findForWrite(hash(key), key);
     if (node == nullptr)
         throw std::out_of_range("Key does not exists");
     return node->pair.second;
@@ -117,19 +211,111 @@ public:
     return Iterator(*this, findNode(key) );
   }
 
-  void remove(const key_type& key)
+  //the mutable iterator to the item of it, whose chain the map takes over from its
+  //snapshots; only a non-const map converts, so a const map never changes
+  iterator toIterator(const const_iterator& it)
   {
-    Node*toRemove=findNode(key);
+    return Iterator(it);
+  }
+
+  void remove(const key_type& key)
+  {
+    const size_t idx=hash(key);
+    Node*toRemove=findForWrite(idx, key);
     if(toRemove==nullptr)
         throw std::out_of_range("can not remove key that not exist in tree");
-    removeNode(toRemove);
-  }
+    unlinkNode(toRemove, idx);
+  }
+
+  //with transparent Hash and KeyEqual keys can be looked up by any type they accept,
+  //e.g. std::string_view for std::string keys, without constructing a key_type
+  template <typename K, typename H=Hash, typename E=KeyEqual,
+            typename=typename H::is_transparent, typename=typename E::is_transparent>
+  const mapped_type& valueOf(const K& key) const
+  {
+    Node* node = findNode(key);
+    if (node == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return node->pair.second;
+  }
+
+  template <typename K, typename H=Hash, typename E=KeyEqual,
+            typename=typename H::is_transparent, typename=typename E::is_transparent>
+  mapped_type& valueOf(const K& key)
+  {
+    Node* node = findForWrite(hash(key), key);
+    if (node == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return node->pair.second;
+  }
+
+  template <typename K, typename H=Hash, typename E=KeyEqual,
+            typename=typename H::is_transparent, typename=typename E::is_transparent>
+  const_iterator find(const K& key) const
+  {
+    return ConstIterator(*this, findNode(key) );
+  }
+
+  template <typename K, typename H=Hash, typename E=KeyEqual,
+            typename=typename H::is_transparent, typename=typename E::is_transparent>
+  iterator find(const K& key)
+  {
+    return Iterator(*this, findNode(key) );
+  }
+
+  template <typename K, typename H=Hash, typename E=KeyEqual,
+            typename=typename H::is_transparent, typename=typename E::is_transparent,
+            typename=typename std::enable_if<!std::is_convertible<K, const_iterator>::value>::type>
+  void remove(const K& key)
+  {
+    const size_t idx=hash(key);
+    Node*toRemove=findForWrite(idx, key);
+    if(toRemove==nullptr)
+        throw std::out_of_range("can not remove key that not exist in tree");
+    unlinkNode(toRemove, idx);
+  }
 
-  void remove(const const_iterator& it)
+  //returns the iterator following the removed item
+  iterator remove(const const_iterator& it)
+  {
+    return erase(it);
+  }
+
+  //removes the item and returns the iterator following it, so that the map can be
+  //purged while it is being iterated
+  iterator erase(const const_iterator& it)
   {
     if (it == end())
-        throw std::out_of_range("Can not remove the end");
-    removeNode(it.currentNode);
+        throw std::out_of_range("Can not remove the end");
+    Node* node=ownNode(it.currentIdx, it.currentNode);
+    ConstIterator next(it);
+    next.currentNode=node;
+    ++next;
+    unlinkNode(node, it.currentIdx);
+    return Iterator(next);
+  }
+
+  //removes all items for which pred(item) is true in a single pass over the buckets,
+  //returns how many were removed
+  template <typename Predicate>
+  size_type eraseIf(Predicate pred)
+  {
+    size_type removed=0;
+    for(size_type i=0; i<bucketCount; ++i){
+        Node* node=tab[i];
+        while(node!=nullptr){
+            if(!pred(static_cast<const_reference>(node->pair))){
+                node=node->nxt;
+                continue;
+            }
+            node=ownNode(i, node);
+            Node* next=node->nxt;
+            unlinkNode(node, i);
+            ++removed;
+            node=next;
+        }
+    }
+    return removed;
   }
 
   size_type getSize() const
@@ -137,11 +323,31 @@ public:
     return size;
   }
 
+  hasher hash_function() const
+  {
+    return hashKey;
+  }
+
+  key_equal key_eq() const
+  {
+    return equalKeys;
+  }
+
   bool operator==(const HashMap& other) const
   {
-    if(size!=other.size)
+    if(size!=other.size || fingerprint!=other.fingerprint)
         return false;
-    Node*tempNode;
+    Node*tempNode;
+    if(bucketCount==other.bucketCount){
+        //same layout, so equal keys sit in buckets of the same index - no rehashing needed
+        for(size_type i=0; i<bucketCount; ++i)
+            for(Node* node=other.tab[i]; node!=nullptr; node=node->nxt){
+                tempNode=findInBucket(i, node->pair.first);
+                if(tempNode==nullptr || tempNode->pair.second!=node->pair.second)
+                    return false;
+            }
+        return true;
+    }
     for(auto&& item:other){
         tempNode=findNode(item.first);
         if(tempNode==nullptr || tempNode->pair.second!=item.second)
@@ -188,10 +394,12 @@ public:
   {
     deleteElementsOfHashMap();
     delete[] tab;
+    delete[] owners;
   }
-size_t hash(const key_type& key) const
+  template <typename K>
+  size_t hash(const K& key) const
   {
-      return std::hash<key_type>{}(key) % bucketCount;
+      return hashKey(key) % bucketCount;
   }
 private:
 /*
@@ -199,11 +407,28 @@ private:
   {
     insert(key, ValueType())
   }*/
+  static void prefetch(const void* address)
+  {
+#if defined(__GNUC__)
+      __builtin_prefetch(address);
+#else
+      (void)address;
+#endif
+  }
+
   Node* insert(const key_type& key,  mapped_type value=ValueType())
   {
+      return insertHashed(hashKey(key), key, std::move(value));
+  }
+
+  //inserts a key that is not in the map yet, fullHash being its hash
+  Node* insertHashed(size_t fullHash, const key_type& key, mapped_type value)
+  {
+      size_t indx=fullHash % bucketCount;
+      ownBucket(indx);
+      Node* newNode= new Node(key, std::move(value));
       ++size;
-      Node* newNode= new Node(key, value);
-      size_t indx=hash(key);
+      fingerprint+=mixBits(fullHash);
       if(tab[indx]!=nullptr){
           tab[indx]->prev=newNode;
           newNode->nxt=tab[indx];
@@ -212,25 +437,123 @@ private:
       return newNode;
   }
 
-  void removeNode(Node* toRemove)
+  //removes a node of bucket idx; a removed chain head passes the bucket to its successor
+  void unlinkNode(Node* toRemove, size_t idx)
   {
-    KeyType key=toRemove->pair.first;
+    fingerprint-=mixBits(hashKey(toRemove->pair.first));
     if(toRemove->prev!=nullptr)
         toRemove->prev->nxt=toRemove->nxt;
-    else if(toRemove->nxt==nullptr)
-        tab[hash(key)]=nullptr;
+    else
+        tab[idx]=toRemove->nxt;
     if(toRemove->nxt!=nullptr)
         toRemove->nxt->prev=toRemove->prev;
     --size;
     delete toRemove;
   }
 
-  Node* findNode(key_type key) const
+  //lookup of a node that is about to be modified: its chain is made private first
+  template <typename K>
+  Node* findForWrite(size_t idx, const K& key)
+  {
+    ownBucket(idx);
+    return findInBucket(idx, key);
+  }
+
+  //makes chain idx private to this map, cloning it if other copies still share it
+  void ownBucket(size_t idx)
+  {
+    if(owners[idx]==nullptr){
+        owners[idx]=new std::atomic<size_type>(1);
+        return;
+    }
+    if(owners[idx]->load(std::memory_order_acquire)==1)
+        return;
+    Node* clone=nullptr;
+    Node* last=nullptr;
+    std::atomic<size_type>* owner=nullptr;
+    try{
+        for(Node* node=tab[idx]; node!=nullptr; node=node->nxt){
+            Node* copy=new Node(node->pair.first, node->pair.second);
+            copy->prev=last;
+            if(last==nullptr)
+                clone=copy;
+            else
+                last->nxt=copy;
+            last=copy;
+        }
+        owner=new std::atomic<size_type>(1);
+    }
+    catch(...){
+        while(clone!=nullptr){
+            Node* temp=clone;
+            clone=clone->nxt;
+            delete temp;
+        }
+        throw;
+    }
+    releaseBucket(idx);
+    tab[idx]=clone;
+    owners[idx]=owner;
+  }
+
+  //ownBucket for a node of chain idx, returns the node's private counterpart
+  Node* ownNode(size_t idx, Node* node)
+  {
+    if(owners[idx]->load(std::memory_order_acquire)==1)
+        return node;
+    size_t position=0;
+    for(Node* tempNode=tab[idx]; tempNode!=node; tempNode=tempNode->nxt)
+        ++position;
+    ownBucket(idx);
+    node=tab[idx];
+    while(position-->0)
+        node=node->nxt;
+    return node;
+  }
+
+  //drops this map's share of chain idx, deleting the chain if it was the last one
+  void releaseBucket(size_t idx)
+  {
+    if(owners[idx]==nullptr)
+        return;
+    if(owners[idx]->fetch_sub(1, std::memory_order_acq_rel)==1){
+        Node* node=tab[idx];
+        while(node!=nullptr){
+            Node* temp=node;
+            node=node->nxt;
+            delete temp;
+        }
+        delete owners[idx];
+    }
+    tab[idx]=nullptr;
+    owners[idx]=nullptr;
+  }
+
+  //takes a share of every chain of other, which has the same bucketCount
+  void shareChainsOf(const HashMap& other)
+  {
+    for(size_type i=0; i<bucketCount; ++i)
+        if(other.tab[i]!=nullptr){
+            other.owners[i]->fetch_add(1, std::memory_order_relaxed);
+            tab[i]=other.tab[i];
+            owners[i]=other.owners[i];
+        }
+    size=other.size;
+    fingerprint=other.fingerprint;
+  }
+
+  template <typename K>
+  Node* findNode(const K& key) const
+  {
+    return findInBucket(hash(key), key);
+  }
+
+  template <typename K>
+  Node* findInBucket(size_t idx, const K& key) const
   {
-    size_t idx=hash(key);
     Node*tempNode=tab[idx];
     while(tempNode!=nullptr){
-       if(tempNode->pair.first==key)
+       if(equalKeys(tempNode->pair.first, key))
             return tempNode;
        tempNode=tempNode->nxt;
     }
@@ -248,18 +571,10 @@ private:
   }
   void deleteElementsOfHashMap()
   {
-    Node* node;
-    Node* temp;
-    for (size_type i = 0; i < bucketCount; ++i) {
-        node = tab[i];
-        while (node != nullptr) {
-            temp = node;
-            node = node->nxt;
-            delete temp;
-            --size;
-        }
-        tab[i]=nullptr;
-    }
+    for (size_type i = 0; i < bucketCount; ++i)
+        releaseBucket(i);
+    size=0;
+    fingerprint=0;
   }
 
   Node*getlast() const
@@ -283,11 +598,13 @@ private:
 
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+class HashMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator
 {
-  const HashMap& hashMap; //Node**tab;//
-public:  Node*currentNode;
+protected:
+  const HashMap* hashMap;
+public:
+  Node*currentNode;
   size_t currentIdx;
 
 public:
@@ -296,24 +613,26 @@ public:
   using value_type = typename HashMap::value_type;
   using pointer = const typename HashMap::value_type*;
 
-  explicit ConstIterator(const HashMap& pMap, Node* pNode): hashMap(pMap), currentNode(pNode)
+  explicit ConstIterator(const HashMap& pMap, Node* pNode): hashMap(&pMap), currentNode(pNode)
     {
         if(pNode==nullptr)
-            currentIdx=hashMap.bucketCount;
+            currentIdx=hashMap->bucketCount;
         else
-            currentIdx=hashMap.hash(pNode->pair.first);
+            currentIdx=hashMap->hash(pNode->pair.first);
     }
 
   ConstIterator(const ConstIterator& other): hashMap(other.hashMap), currentNode(other.currentNode), currentIdx(other.currentIdx)
         {}
 
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
   ConstIterator& operator++()
   {
      if(currentNode==nullptr)
         throw std::out_of_range("can not increase end");
      currentNode=currentNode->nxt;
-     while(currentNode==nullptr && ++currentIdx<hashMap.bucketCount){
-         currentNode=hashMap.tab[currentIdx];
+     while(currentNode==nullptr && ++currentIdx<hashMap->bucketCount){
+         currentNode=hashMap->tab[currentIdx];
      }
     return *this;
   }
@@ -327,17 +646,18 @@ public:
 
   ConstIterator& operator--()
   {
-     if(hashMap.size==0)
+     if(hashMap->size==0)
         throw std::out_of_range("can not deincrement empty collection");
-     if(currentNode==hashMap.getFirst())
+     if(currentNode==hashMap->getFirst())
         throw std::out_of_range("can not deincrement begin");
      if(currentNode==nullptr){
-        currentNode=hashMap.getlast();
+        currentNode=hashMap->getlast();
+        currentIdx=hashMap->hash(currentNode->pair.first);
         return *this;
      }
      currentNode=currentNode->prev;
      while(currentNode==nullptr && --currentIdx>0){
-         currentNode=hashMap.tab[currentIdx];
+         currentNode=hashMap->tab[currentIdx];
      }
     return *this;
   }
@@ -374,45 +694,48 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::Iterator : public HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+class HashMap<KeyType, ValueType, Hash, KeyEqual>::Iterator : public HashMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator
 {
 public:
   using reference = typename HashMap::reference;
   using pointer = typename HashMap::value_type*;
 
-  explicit Iterator(const HashMap& pMap, Node* pNode)
-        : ConstIterator(pMap, pNode)
-            {}
-
-  Iterator(const ConstIterator& other)
-    : ConstIterator(other)
-    {}
-
-  Iterator& operator++()
-  {
-    ConstIterator::operator++();
-    return *this;
-  }
-
-  Iterator operator++(int)
-  {
-    auto result = *this;
-    ConstIterator::operator++();
-    return result;
-  }
-
-  Iterator& operator--()
-  {
-    ConstIterator::operator--();
-    return *this;
-  }
-
-  Iterator operator--(int)
-  {
-    auto result = *this;
-    ConstIterator::operator--();
-    return result;
+  //a mutable iterator only ever points into chains its map owns, so writes through it
+  //cannot reach the snapshots sharing the other chains; only a non-const map hands one
+  //out, a const_iterator becomes one through HashMap::toIterator
+  explicit Iterator(HashMap& pMap, Node* pNode)
+        : ConstIterator(pMap, pNode)
+            {
+              own();
+            }
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    own();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    own();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    operator--();
+    return result;
   }
 
   pointer operator->() const
@@ -425,18 +748,35 @@ public:
     // ugly cast, yet reduces code duplication.
     return const_cast<reference>(ConstIterator::operator*());
   }
+
+private:
+  friend class HashMap;
+
+  //for the map's own members, which are non-const
+  explicit Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+    {
+      own();
+    }
+
+  //the map is not const: the iterator was made by one of its non-const members
+  void own()
+  {
+    if(this->currentNode!=nullptr)
+        this->currentNode=const_cast<HashMap*>(this->hashMap)->ownNode(this->currentIdx, this->currentNode);
+  }
 };
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>:: Node
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+class HashMap<KeyType, ValueType, Hash, KeyEqual>:: Node
 {
     friend class HashMap;
     Node* nxt;
     Node* prev;
     value_type pair;
 public:
-    Node() : pair(), nxt(nullptr), prev(nullptr)
+    Node() : nxt(nullptr), prev(nullptr), pair()
             {};
-    Node(KeyType key, ValueType value) : pair(std::make_pair(key,value)), nxt(nullptr), prev(nullptr)
+    Node(KeyType key, ValueType value) : nxt(nullptr), prev(nullptr), pair(std::move(key), std::move(value))
             {}
 };
 }
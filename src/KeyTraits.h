@@ -0,0 +1,90 @@
+#ifndef AISDI_MAPS_KEYTRAITS_H
+#define AISDI_MAPS_KEYTRAITS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace aisdi
+{
+
+//transparent hashing and comparison of strings: maps keyed by std::string can be
+//searched by std::string_view or const char* without building a temporary key
+struct StringHash
+{
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view key) const noexcept
+  {
+    return std::hash<std::string_view>{}(key);
+  }
+};
+
+struct StringEqual
+{
+  using is_transparent = void;
+
+  bool operator()(std::string_view a, std::string_view b) const noexcept
+  {
+    return a == b;
+  }
+};
+
+struct StringLess
+{
+  using is_transparent = void;
+
+  bool operator()(std::string_view a, std::string_view b) const noexcept
+  {
+    return a < b;
+  }
+};
+
+//hash, equality and order used by the maps unless given explicitly
+template <typename Key>
+struct KeyTraits
+{
+  using Hash = std::hash<Key>;
+  using KeyEqual = std::equal_to<Key>;
+  using Compare = std::less<Key>;
+};
+
+template <>
+struct KeyTraits<std::string>
+{
+  using Hash = StringHash;
+  using KeyEqual = StringEqual;
+  using Compare = StringLess;
+};
+
+template <typename Key>
+using DefaultHash = typename KeyTraits<Key>::Hash;
+
+template <typename Key>
+using DefaultKeyEqual = typename KeyTraits<Key>::KeyEqual;
+
+template <typename Key>
+using DefaultCompare = typename KeyTraits<Key>::Compare;
+
+//the splitmix64 finalizer: spreads the bits of x over the whole word, for hashes such
+//as std::hash of an integer, which is the identity
+inline std::uint64_t mixBits(std::uint64_t x)
+{
+  x=(x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+  x=(x^(x>>27))*0x94d049bb133111ebULL;
+  return x^(x>>31);
+}
+
+//a random word from a splitmix64 stream of the calling thread's own, for tree priorities
+//and skip list levels
+inline std::uint64_t threadRandom()
+{
+  static thread_local std::uint64_t state=reinterpret_cast<std::uintptr_t>(&state);
+  return mixBits(state+=0x9e3779b97f4a7c15ULL);
+}
+
+}
+
+#endif /* AISDI_MAPS_KEYTRAITS_H */
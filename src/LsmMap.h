@@ -0,0 +1,301 @@
+#ifndef AISDI_MAPS_LSMMAP_H
+#define AISDI_MAPS_LSMMAP_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BloomFilter.h"
+#include "KeyTraits.h"
+#include "TreeMap.h"
+
+namespace aisdi
+{
+
+//a write-optimised map in the manner of a log-structured merge tree: writes only touch an
+//in-memory TreeMap, the memtable, which is frozen into an immutable sorted run when it
+//fills up; a worker thread merges runs once there are too many of them, size-tiered.
+//A lookup checks the memtable and then the runs from the newest, skipping the runs whose
+//Bloom filter rules the key out. Writes are blind - inserting and erasing never look at
+//the runs - so there is no size and erasing a missing key is not an error; removals are
+//recorded as tombstones, dropped by compaction. Values are returned by copy, since the
+//runs holding them may be replaced at any time. The map itself is for one thread at a
+//time, like TreeMap; only the compaction runs beside it. A compaction that throws leaves
+//the runs as they were and its exception is rethrown by the next flush() or
+//waitForCompaction(); the worker tries again only after that
+template <typename KeyType, typename ValueType, typename Compare = DefaultCompare<KeyType>,
+          typename Hash = DefaultHash<KeyType>>
+class LsmMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using key_compare = Compare;
+  using hasher = Hash;
+  using size_type = std::size_t;
+
+private:
+  using Entry = std::optional<mapped_type>;//nullopt is a tombstone
+  class Run;
+  using RunPtr = std::shared_ptr<const Run>;
+
+  TreeMap<key_type, Entry, Compare> memtable;
+  size_type memtableCapacity;
+  size_type compactAt;//number of runs that triggers a compaction
+  Compare compare;
+  Hash hashKey;
+
+  mutable std::mutex mutex;//guards the members below
+  mutable std::condition_variable changed;
+  std::vector<RunPtr> runs;//newest first
+  bool compacting=false;
+  bool stopping=false;
+  mutable std::exception_ptr failure;//of the last compaction, until it is rethrown
+  std::thread worker;
+
+public:
+  explicit LsmMap(size_type pMemtableCapacity=4096, size_type pCompactAt=4)
+    : memtableCapacity(std::max<size_type>(pMemtableCapacity, 1)), compactAt(std::max<size_type>(pCompactAt, 2))
+  {
+    worker=std::thread([this]() { compactInBackground(); });
+  }
+
+  LsmMap(const LsmMap&) = delete;
+  LsmMap& operator=(const LsmMap&) = delete;
+
+  ~LsmMap()
+  {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping=true;
+    }
+    changed.notify_all();
+    worker.join();
+  }
+
+  //maps key to value, whether it was in the map or not
+  void insert(const key_type& key, const mapped_type& value)
+  {
+    write(key, Entry(value));
+  }
+
+  void erase(const key_type& key)
+  {
+    write(key, Entry());
+  }
+
+  //a copy of the value of key, throws std::out_of_range if there is no such key
+  mapped_type valueOf(const key_type& key) const
+  {
+    Entry entry=lookup(key);
+    if (!entry)
+        throw std::out_of_range("Key does not exists");
+    return std::move(*entry);
+  }
+
+  bool contains(const key_type& key) const
+  {
+    return lookup(key).has_value();
+  }
+
+  //freezes the memtable into a run even if it is not full
+  void flush()
+  {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rethrowFailure();
+    }
+    if(memtable.isEmpty())
+        return;
+    RunPtr run=std::make_shared<const Run>(memtable, hashKey);
+    memtable=TreeMap<key_type, Entry, Compare>(compare);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        runs.insert(runs.begin(), std::move(run));
+    }
+    changed.notify_all();
+  }
+
+  //blocks until the worker has no runs left to merge or a compaction has failed
+  void waitForCompaction() const
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return failure || (!compacting && runs.size()<compactAt); });
+    rethrowFailure();
+  }
+
+  size_type getRunCount() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return runs.size();
+  }
+
+private:
+  void write(const key_type& key, Entry entry)
+  {
+    memtable[key]=std::move(entry);
+    if(memtable.getSize()>=memtableCapacity)
+        flush();
+  }
+
+  //with the mutex held; lets the worker compact again
+  void rethrowFailure() const
+  {
+    if(!failure)
+        return;
+    std::exception_ptr thrown=std::move(failure);
+    failure=nullptr;
+    changed.notify_all();
+    std::rethrow_exception(thrown);
+  }
+
+  Entry lookup(const key_type& key) const
+  {
+    auto it=memtable.find(key);
+    if(it!=memtable.end())
+        return it->second;
+    const std::uint64_t hash=hashKey(key);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto&& run : runs){
+        if(!run->filter.mayContain(hash))
+            continue;
+        const Entry* entry=run->find(key, compare);
+        if(entry!=nullptr)
+            return *entry;
+    }
+    return Entry();
+  }
+
+  void compactInBackground()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true){
+        changed.wait(lock, [this]() { return stopping || (!failure && runs.size()>=compactAt); });
+        if(stopping)
+            return;
+        compacting=true;
+        const std::vector<RunPtr> snapshot(runs);
+        //the newest runs, and each older one no larger than them together, so that every
+        //item is rewritten about log(n/memtableCapacity) times
+        size_type merged=compactAt;
+        size_type size=0;
+        for (size_type i=0; i<merged; ++i)
+            size+=snapshot[i]->keys.size();
+        for (; merged<snapshot.size() && snapshot[merged]->keys.size()<=size; ++merged)
+            size+=snapshot[merged]->keys.size();
+        lock.unlock();
+        RunPtr result;
+        try{
+            result=mergeRuns(snapshot, merged);
+        }
+        catch(...){
+            lock.lock();
+            failure=std::current_exception();
+            compacting=false;
+            changed.notify_all();
+            continue;
+        }
+        lock.lock();
+        //runs frozen meanwhile are newer than the merged ones and stay in front of them
+        const auto first=runs.begin()+(runs.size()-snapshot.size());
+        const size_type kept=result!=nullptr ? 1 : 0;
+        if(kept!=0)
+            *first=std::move(result);
+        runs.erase(first+kept, first+merged);
+        compacting=false;
+        changed.notify_all();
+    }
+  }
+
+  //merges the newest count runs into one; a key takes its newest entry, tombstones are
+  //dropped only when no older run is left for them to hide
+  RunPtr mergeRuns(const std::vector<RunPtr>& all, size_type count) const
+  {
+    const bool oldest=count==all.size();
+    std::vector<size_type> positions(count, 0);
+    std::vector<key_type> keys;
+    std::vector<Entry> entries;
+    while(true){
+        //the smallest key at any position, the newest run wins a tie
+        size_type smallest=count;
+        for (size_type i=0; i<count; ++i){
+            if(positions[i]==all[i]->keys.size())
+                continue;
+            if(smallest==count || compare(all[i]->keys[positions[i]], all[smallest]->keys[positions[smallest]]))
+                smallest=i;
+        }
+        if(smallest==count)
+            break;
+        const key_type& key=all[smallest]->keys[positions[smallest]];
+        const Entry& entry=all[smallest]->entries[positions[smallest]];
+        if(entry || !oldest){
+            keys.push_back(key);
+            entries.push_back(entry);
+        }
+        for (size_type i=0; i<count; ++i)
+            if(i!=smallest && positions[i]<all[i]->keys.size() && !compare(key, all[i]->keys[positions[i]]))
+                ++positions[i];
+        ++positions[smallest];
+    }
+    if(keys.empty())
+        return nullptr;
+    return std::make_shared<const Run>(std::move(keys), std::move(entries), hashKey);
+  }
+};
+
+//an immutable sorted run of keys and entries, with the filter of its keys
+template <typename KeyType, typename ValueType, typename Compare, typename Hash>
+class LsmMap<KeyType, ValueType, Compare, Hash>::Run
+{
+    friend class LsmMap;
+    std::vector<key_type> keys;
+    std::vector<Entry> entries;
+    BloomFilter filter;
+
+public:
+    Run(const TreeMap<key_type, Entry, Compare>& memtable, const Hash& hashKey)
+        : filter(memtable.getSize())
+    {
+        keys.reserve(memtable.getSize());
+        entries.reserve(memtable.getSize());
+        for (auto&& item : memtable){
+            keys.push_back(item.first);
+            entries.push_back(item.second);
+        }
+        addKeys(hashKey);
+    }
+
+    Run(std::vector<key_type> pKeys, std::vector<Entry> pEntries, const Hash& hashKey)
+        : keys(std::move(pKeys)), entries(std::move(pEntries)), filter(keys.size())
+    {
+        addKeys(hashKey);
+    }
+
+    const Entry* find(const key_type& key, const Compare& compare) const
+    {
+        auto it=std::lower_bound(keys.begin(), keys.end(), key, compare);
+        if(it==keys.end() || compare(key, *it))
+            return nullptr;
+        return &entries[it-keys.begin()];
+    }
+
+private:
+    void addKeys(const Hash& hashKey)
+    {
+        for (auto&& key : keys)
+            filter.insert(hashKey(key));
+    }
+};
+
+}
+
+#endif /* AISDI_MAPS_LSMMAP_H */
@@ -0,0 +1,427 @@
+#ifndef AISDI_MAPS_PERSISTENTTREEMAP_H
+#define AISDI_MAPS_PERSISTENTTREEMAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Epochs.h"
+#include "KeyTraits.h"
+
+namespace aisdi
+{
+
+//an immutable ordered map: insert and remove leave the map unchanged and return a new
+//version which shares every untouched node with it; the tree is a treap like TreeMap's,
+//but nodes have no parent or list links, so an update copies only the O(log n) expected
+//nodes on its path; nodes are reference counted and freed with the last version using them
+template <typename KeyType, typename ValueType, typename Compare = DefaultCompare<KeyType>>
+class PersistentTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using key_compare = Compare;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = const value_type&;
+  using const_reference = const value_type&;
+
+  class Node;
+  class ConstIterator;
+  class Published;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  using NodePtr = std::shared_ptr<const Node>;
+
+  NodePtr root;
+  Compare compare;//keys are equal when neither is less than the other
+
+public:
+  PersistentTreeMap()
+  {}
+
+  explicit PersistentTreeMap(const Compare& pCompare): compare(pCompare)
+  {}
+
+  PersistentTreeMap(std::initializer_list<value_type> list, const Compare& pCompare=Compare())
+    : PersistentTreeMap(list.begin(), list.end(), pCompare)
+  {}
+
+  //for repeated keys the last value wins
+  template <typename InputIt>
+  PersistentTreeMap(InputIt first, InputIt last, const Compare& pCompare=Compare()): compare(pCompare)
+  {
+    for (; first!=last; ++first)
+        root=insertInto(root, first->first, first->second, randomPriority());
+  }
+
+  bool isEmpty() const
+  {
+    return root==nullptr;
+  }
+
+  size_type getSize() const
+  {
+    return weightOf(root.get());
+  }
+
+  key_compare key_comp() const
+  {
+    return compare;
+  }
+
+  //the version in which key maps to value, whether it was in this one or not
+  PersistentTreeMap insert(const key_type& key, const mapped_type& value) const
+  {
+    return PersistentTreeMap(insertInto(root, key, value, randomPriority()), compare);
+  }
+
+  //the version without key, throws std::out_of_range if there is no such key
+  PersistentTreeMap remove(const key_type& key) const
+  {
+    return PersistentTreeMap(removeFrom(root, key), compare);
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    const Node* node=findNode(key);
+    if (node == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return node->pair.second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    ConstIterator it(root.get());
+    for (const Node* node=root.get(); node!=nullptr; ) {
+        it.path.push_back(node);
+        if(compare(key, node->pair.first))
+            node=node->left.get();
+        else if(compare(node->pair.first, key))
+            node=node->right.get();
+        else
+            return it;
+    }
+    return end();
+  }
+
+  const_reference min() const
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not get min of empty collection");
+    return *begin();
+  }
+
+  const_reference max() const
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not get max of empty collection");
+    const Node* node=root.get();
+    while(node->right!=nullptr)
+        node=node->right.get();
+    return node->pair;
+  }
+
+  bool operator==(const PersistentTreeMap& other) const
+  {
+    if (root==other.root)
+        return true;
+    if (getSize() != other.getSize())
+        return false;
+    for (auto it=begin(), otherIt=other.begin(); it!=end(); ++it, ++otherIt)
+        if (compare(it->first, otherIt->first) || compare(otherIt->first, it->first)
+            || it->second != otherIt->second)
+            return false;
+    return true;
+  }
+
+  bool operator!=(const PersistentTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const
+  {
+    ConstIterator it(root.get());
+    it.descendLeft(root.get());
+    return it;
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(root.get());
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+
+private:
+  PersistentTreeMap(NodePtr pRoot, const Compare& pCompare): root(std::move(pRoot)), compare(pCompare)
+  {}
+
+  static size_type weightOf(const Node* node)
+  {
+      return node==nullptr ? 0 : node->weight;
+  }
+
+  static NodePtr makeNode(value_type pair, std::uint64_t priority, NodePtr left, NodePtr right)
+  {
+      return std::make_shared<const Node>(std::move(pair), priority, std::move(left), std::move(right));
+  }
+
+  //copies the path to key; the new node rises above the copies of lower priority
+  //by rotations, which copy one more node each
+  NodePtr insertInto(const NodePtr& node, const key_type& key, const mapped_type& value, std::uint64_t priority) const
+  {
+      if(node==nullptr)
+          return makeNode(value_type(key, value), priority, nullptr, nullptr);
+      if(compare(key, node->pair.first)){
+          NodePtr left=insertInto(node->left, key, value, priority);
+          if(left->priority>node->priority)
+              return makeNode(left->pair, left->priority, left->left,
+                              makeNode(node->pair, node->priority, left->right, node->right));
+          return makeNode(node->pair, node->priority, std::move(left), node->right);
+      }
+      if(compare(node->pair.first, key)){
+          NodePtr right=insertInto(node->right, key, value, priority);
+          if(right->priority>node->priority)
+              return makeNode(right->pair, right->priority,
+                              makeNode(node->pair, node->priority, node->left, right->left), right->right);
+          return makeNode(node->pair, node->priority, node->left, std::move(right));
+      }
+      return makeNode(value_type(node->pair.first, value), node->priority, node->left, node->right);
+  }
+
+  NodePtr removeFrom(const NodePtr& node, const key_type& key) const
+  {
+      if(node==nullptr)
+          throw std::out_of_range("can not remove key that not exist in tree");
+      if(compare(key, node->pair.first))
+          return makeNode(node->pair, node->priority, removeFrom(node->left, key), node->right);
+      if(compare(node->pair.first, key))
+          return makeNode(node->pair, node->priority, node->left, removeFrom(node->right, key));
+      return joinNodes(node->left, node->right);
+  }
+
+  //all keys of left are smaller than those of right; copies the spines it walks down
+  static NodePtr joinNodes(const NodePtr& left, const NodePtr& right)
+  {
+      if(left==nullptr)
+          return right;
+      if(right==nullptr)
+          return left;
+      if(left->priority>right->priority)
+          return makeNode(left->pair, left->priority, left->left, joinNodes(left->right, right));
+      return makeNode(right->pair, right->priority, joinNodes(left, right->left), right->right);
+  }
+
+  const Node* findNode(const key_type& key) const
+  {
+      const Node* node=root.get();
+      while(node!=nullptr){
+          if(compare(key, node->pair.first))
+              node=node->left.get();
+          else if(compare(node->pair.first, key))
+              node=node->right.get();
+          else
+              return node;
+      }
+      return nullptr;
+  }
+
+  static std::uint64_t randomPriority()
+  {
+      return threadRandom();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class PersistentTreeMap<KeyType, ValueType, Compare>::Node
+{
+    friend class PersistentTreeMap;
+    friend class ConstIterator;
+    value_type pair;
+    std::uint64_t priority;
+    size_type weight;//number of nodes in the subtree
+    NodePtr left;
+    NodePtr right;
+public:
+    Node(value_type pPair, std::uint64_t pPriority, NodePtr pLeft, NodePtr pRight)
+        : pair(std::move(pPair)), priority(pPriority),
+          weight(1+weightOf(pLeft.get())+weightOf(pRight.get())),
+          left(std::move(pLeft)), right(std::move(pRight))
+            {}
+};
+
+//nodes have no parent links, so the iterator keeps the path from the root;
+//it stays valid as long as some version holding its nodes does
+template <typename KeyType, typename ValueType, typename Compare>
+class PersistentTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+  friend class PersistentTreeMap;
+  const Node* root;
+  std::vector<const Node*> path;//empty for end()
+
+  explicit ConstIterator(const Node* pRoot): root(pRoot)
+  {}
+
+public:
+  using reference = typename PersistentTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename PersistentTreeMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename PersistentTreeMap::value_type*;
+
+  ConstIterator& operator++()
+  {
+    if(path.empty())
+        throw std::out_of_range("can not increase end");
+    const Node* node=path.back();
+    if(node->right!=nullptr){
+        descendLeft(node->right.get());
+        return *this;
+    }
+    path.pop_back();
+    while(!path.empty() && path.back()->right.get()==node){
+        node=path.back();
+        path.pop_back();
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(path.empty()){
+        if(root==nullptr)
+            throw std::out_of_range("can not deincrement empty collection");
+        descendRight(root);
+        return *this;
+    }
+    const Node* node=path.back();
+    if(node->left!=nullptr){
+        descendRight(node->left.get());
+        return *this;
+    }
+    path.pop_back();
+    while(!path.empty() && path.back()->left.get()==node){
+        node=path.back();
+        path.pop_back();
+    }
+    if(path.empty())
+        throw std::out_of_range("can not deincrement begin");
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(path.empty())
+        throw std::out_of_range("can not dereferent iterator of end");
+    return path.back()->pair;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return (path.empty() ? nullptr : path.back()) == (other.path.empty() ? nullptr : other.path.back());
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  void descendLeft(const Node* node)
+  {
+    for (; node!=nullptr; node=node->left.get())
+        path.push_back(node);
+  }
+
+  void descendRight(const Node* node)
+  {
+    for (; node!=nullptr; node=node->right.get())
+        path.push_back(node);
+  }
+};
+
+//the latest version of a map updated by one writer and read by any number of threads:
+//store() swaps in a pointer to the new root and load() copies the root it reads, so a
+//reader gets either the old or the new version, never a half-made one, and neither of
+//them takes a lock. A replaced root is freed by epoch-based reclamation once no load()
+//can still be copying it, so a few recent versions may outlive their store() for a while
+template <typename KeyType, typename ValueType, typename Compare>
+class PersistentTreeMap<KeyType, ValueType, Compare>::Published
+{
+  std::atomic<const NodePtr*> root;
+  Compare compare;
+  Epochs epochs;
+
+public:
+  explicit Published(const PersistentTreeMap& version=PersistentTreeMap())
+    : root(new NodePtr(version.root)), compare(version.compare)
+  {}
+
+  Published(const Published&) = delete;
+  Published& operator=(const Published&) = delete;
+
+  ~Published()
+  {
+    delete root.load(std::memory_order_relaxed);
+  }
+
+  PersistentTreeMap load() const
+  {
+    Epochs::Record* record=epochs.pin();
+    NodePtr latest=*root.load(std::memory_order_seq_cst);
+    epochs.unpin(record);
+    return PersistentTreeMap(std::move(latest), compare);
+  }
+
+  void store(const PersistentTreeMap& version)
+  {
+    const NodePtr* fresh=new NodePtr(version.root);
+    const NodePtr* replaced=root.exchange(fresh, std::memory_order_seq_cst);
+    Epochs::Record* record=epochs.pin();
+    epochs.retire(record, const_cast<NodePtr*>(replaced),
+                  [](void* pointer) { delete static_cast<NodePtr*>(pointer); });
+    epochs.unpin(record);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_PERSISTENTTREEMAP_H */
@@ -0,0 +1,1227 @@
+#ifndef AISDI_MAPS_RADIXTREEMAP_H
+#define AISDI_MAPS_RADIXTREEMAP_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aisdi
+{
+
+//the bytes of a key in an order that compares like the key: integers are stored big-endian,
+//signed ones with the sign bit flipped, strings are their own bytes
+template <typename Key, typename=void>
+struct RadixKey;
+
+template <typename Key>
+struct RadixKey<Key, typename std::enable_if<std::is_integral<Key>::value>::type>
+{
+  using Bytes = std::array<unsigned char, sizeof(Key)>;
+
+  static Bytes bytes(Key key)
+  {
+    using Unsigned = typename std::make_unsigned<Key>::type;
+    Unsigned bits=static_cast<Unsigned>(key);
+    if(std::is_signed<Key>::value)
+        bits^=Unsigned(Unsigned(1) << (8*sizeof(Key)-1));
+    Bytes result;
+    for (std::size_t i=sizeof(Key); i-->0; bits=Unsigned(bits >> 8))
+        result[i]=static_cast<unsigned char>(bits);
+    return result;
+  }
+};
+
+template <>
+struct RadixKey<std::string>
+{
+  using Bytes = std::string_view;
+
+  static Bytes bytes(const std::string& key)
+  {
+    return key;
+  }
+};
+
+//an ordered map for keys that are byte strings, see RadixKey: an adaptive radix tree
+//(Leis et al.) branches on one key byte per level in nodes of 4, 16, 48 or 256 children
+//that grow and shrink with their fan-out; chains of single children are compressed into
+//the prefix of the node below and a lone key is kept in a leaf as high as it can go, so
+//a lookup reads at most one node per key byte whatever the number of items. Leaves are
+//threaded into an in-order list, as in TreeMap, for iteration and neighbour lookups
+template <typename KeyType, typename ValueType>
+class RadixTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  class Node;
+  class Leaf;
+  class Inner;
+  class Node4;
+  class Node16;
+  class Node48;
+  class Node256;
+
+  using Traits = RadixKey<key_type>;
+  using Bytes = typename Traits::Bytes;
+
+  enum NodeType : std::uint8_t { LEAF, NODE4, NODE16, NODE48, NODE256 };
+
+  Node* root=nullptr;
+  Leaf* leftmost=nullptr;
+  Leaf* rightmost=nullptr;
+  size_type size=0;
+
+public:
+  RadixTreeMap()
+  {}
+
+  RadixTreeMap(std::initializer_list<value_type> list)
+    : RadixTreeMap(list.begin(), list.end())
+  {}
+
+  //for repeated keys the last value wins
+  template <typename InputIt>
+  RadixTreeMap(InputIt first, InputIt last)
+  {
+    try{
+        for (; first!=last; ++first)
+            (*this)[first->first]=first->second;
+    }
+    catch(...){
+        clear();
+        throw;
+    }
+  }
+
+  RadixTreeMap(const RadixTreeMap& other)
+  {
+    Leaf* last=nullptr;
+    try{
+        root=cloneNode(other.root, last);
+    }
+    catch(...){
+        //the leaves cloned so far are all on the list
+        for (Leaf* leaf=last; leaf!=nullptr; ){
+            Leaf* prev=leaf->prev;
+            delete leaf;
+            leaf=prev;
+        }
+        throw;
+    }
+    rightmost=last;
+    size=other.size;
+  }
+
+  RadixTreeMap(RadixTreeMap&& other)
+  {
+    swap(other);
+  }
+
+  RadixTreeMap& operator=(const RadixTreeMap& other)
+  {
+    if(this!=&other){
+        RadixTreeMap copy(other);
+        swap(copy);
+    }
+    return *this;
+  }
+
+  RadixTreeMap& operator=(RadixTreeMap&& other)
+  {
+    if(this!=&other){
+        clear();
+        swap(other);
+    }
+    return *this;
+  }
+
+  ~RadixTreeMap()
+  {
+    clear();
+  }
+
+  bool isEmpty() const
+  {
+    return size==0;
+  }
+
+  size_type getSize() const
+  {
+    return size;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    Leaf* leaf=findLeaf(key);
+    if(leaf==nullptr)
+        leaf=insert(key);
+    return leaf->pair.second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    Leaf* leaf=findLeaf(key);
+    if (leaf == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return leaf->pair.second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    Leaf* leaf=findLeaf(key);
+    if (leaf == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return leaf->pair.second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return ConstIterator(*this, findLeaf(key));
+  }
+
+  iterator find(const key_type& key)
+  {
+    return Iterator(*this, findLeaf(key));
+  }
+
+  //the first item with a key not smaller than key
+  const_iterator lower_bound(const key_type& key) const
+  {
+    return ConstIterator(*this, lowerBoundLeaf(key));
+  }
+
+  iterator lower_bound(const key_type& key)
+  {
+    return Iterator(*this, lowerBoundLeaf(key));
+  }
+
+  void remove(const key_type& key)
+  {
+    if(!removeLeaf(key))
+        throw std::out_of_range("can not remove key that not exist in tree");
+  }
+
+  //returns the iterator following the removed item
+  iterator remove(const const_iterator& it)
+  {
+    if (it == end())
+        throw std::out_of_range("Can not remove the end");
+    Leaf* next=it.current->next;
+    removeLeaf(it.current->pair.first);
+    return iterator(*this, next);
+  }
+
+  bool operator==(const RadixTreeMap& other) const
+  {
+    if (size != other.size)
+        return false;
+    for (Leaf *leaf = leftmost, *otherLeaf = other.leftmost; leaf != nullptr;
+         leaf = leaf->next, otherLeaf = otherLeaf->next) {
+        if (!(leaf->pair.first == otherLeaf->pair.first) || leaf->pair.second != otherLeaf->pair.second)
+            return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const RadixTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return iterator(*this, leftmost);
+  }
+
+  iterator end()
+  {
+    return iterator(*this, nullptr);
+  }
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator(*this, leftmost);
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(*this, nullptr);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+
+private:
+  void swap(RadixTreeMap& other)
+  {
+    std::swap(root, other.root);
+    std::swap(leftmost, other.leftmost);
+    std::swap(rightmost, other.rightmost);
+    std::swap(size, other.size);
+  }
+
+  void clear()
+  {
+    deleteNode(root);
+    root=nullptr;
+    leftmost=nullptr;
+    rightmost=nullptr;
+    size=0;
+  }
+
+  static unsigned char byteAt(const Bytes& bytes, std::size_t i)
+  {
+    return static_cast<unsigned char>(bytes[i]);
+  }
+
+  static Bytes bytesOf(const Leaf* leaf)
+  {
+    return Traits::bytes(leaf->pair.first);
+  }
+
+  //length of the common part of prefix and key from depth on
+  static std::size_t matchPrefix(const std::string& prefix, const Bytes& key, std::size_t depth)
+  {
+    const std::size_t limit=std::min(prefix.size(), key.size()-depth);
+    std::size_t i=0;
+    while(i<limit && static_cast<unsigned char>(prefix[i])==byteAt(key, depth+i))
+        ++i;
+    return i;
+  }
+
+  Leaf* findLeaf(const key_type& key) const
+  {
+    const Bytes bytes=Traits::bytes(key);
+    const Node* node=root;
+    std::size_t depth=0;
+    while(node!=nullptr){
+        if(node->type==LEAF){
+            const Leaf* leaf=static_cast<const Leaf*>(node);
+            const Bytes leafBytes=bytesOf(leaf);
+            if(leafBytes.size()!=bytes.size()
+               || std::memcmp(leafBytes.data(), bytes.data(), bytes.size())!=0)
+                return nullptr;
+            return const_cast<Leaf*>(leaf);
+        }
+        const Inner* inner=static_cast<const Inner*>(node);
+        const std::size_t length=inner->prefix.size();
+        if(bytes.size()-depth<length
+           || std::memcmp(inner->prefix.data(), bytes.data()+depth, length)!=0)
+            return nullptr;
+        depth+=length;
+        if(depth==bytes.size())
+            return inner->terminal;
+        Node* const* child=findChild(inner, byteAt(bytes, depth));
+        if(child==nullptr)
+            return nullptr;
+        node=*child;
+        ++depth;
+    }
+    return nullptr;
+  }
+
+  Leaf* lowerBoundLeaf(const key_type& key) const
+  {
+    const Bytes bytes=Traits::bytes(key);
+    const Node* node=root;
+    std::size_t depth=0;
+    while(node!=nullptr){
+        if(node->type==LEAF){
+            Leaf* leaf=const_cast<Leaf*>(static_cast<const Leaf*>(node));
+            //keys between the leaf and key would share the path to it, so there are none
+            return compareBytes(bytesOf(leaf), bytes)<0 ? leaf->next : leaf;
+        }
+        const Inner* inner=static_cast<const Inner*>(node);
+        const std::size_t matched=matchPrefix(inner->prefix, bytes, depth);
+        if(matched<inner->prefix.size()){
+            if(depth+matched==bytes.size()
+               || byteAt(bytes, depth+matched)<static_cast<unsigned char>(inner->prefix[matched]))
+                return minLeaf(node);
+            return maxLeaf(node)->next;
+        }
+        depth+=matched;
+        if(depth==bytes.size())
+            return minLeaf(node);
+        const unsigned char byte=byteAt(bytes, depth);
+        Node* const* child=findChild(inner, byte);
+        if(child==nullptr){
+            Node* greater=childAfter(inner, byte);
+            return greater!=nullptr ? minLeaf(greater) : maxLeaf(node)->next;
+        }
+        node=*child;
+        ++depth;
+    }
+    return nullptr;
+  }
+
+  static int compareBytes(const Bytes& a, const Bytes& b)
+  {
+    const std::size_t common=std::min(a.size(), b.size());
+    const int result=common==0 ? 0 : std::memcmp(a.data(), b.data(), common);
+    if(result!=0)
+        return result;
+    return a.size()<b.size() ? -1 : (a.size()>b.size() ? 1 : 0);
+  }
+
+  //inserts a key that is not in the map yet and links its leaf between its neighbours
+  Leaf* insert(const key_type& key)
+  {
+    const Bytes bytes=Traits::bytes(key);
+    std::unique_ptr<Leaf> fresh(new Leaf(value_type(key, mapped_type())));
+    Leaf* leaf=fresh.get();
+    if(root==nullptr){
+        root=fresh.release();
+        leftmost=rightmost=leaf;
+        ++size;
+        return leaf;
+    }
+    Node** ref=&root;
+    std::size_t depth=0;
+    while(true){
+        Node* node=*ref;
+        if(node->type==LEAF){
+            //lazy expansion: the lone leaf gets a parent branching where the keys differ
+            Leaf* other=static_cast<Leaf*>(node);
+            const Bytes otherBytes=bytesOf(other);
+            std::size_t common=depth;
+            while(common<bytes.size() && common<otherBytes.size()
+                  && byteAt(bytes, common)==byteAt(otherBytes, common))
+                ++common;
+            std::unique_ptr<Node4> parent(new Node4(prefixOf(bytes, depth, common)));
+            place(parent.get(), other, otherBytes, common);
+            place(parent.get(), fresh.release(), bytes, common);
+            *ref=parent.release();
+            if(compareBytes(bytes, otherBytes)<0)
+                linkBefore(leaf, other);
+            else
+                linkAfter(leaf, other);
+            break;
+        }
+        Inner* inner=static_cast<Inner*>(node);
+        const std::size_t matched=matchPrefix(inner->prefix, bytes, depth);
+        if(matched<inner->prefix.size()){
+            //the key leaves the compressed path: split it with a new parent
+            const unsigned char innerByte=static_cast<unsigned char>(inner->prefix[matched]);
+            std::unique_ptr<Node4> parent(new Node4(inner->prefix.substr(0, matched)));
+            inner->prefix.erase(0, matched+1);
+            addSorted(parent.get(), innerByte, inner);
+            if(depth+matched==bytes.size()){
+                parent->terminal=fresh.release();
+                linkBefore(leaf, minLeaf(inner));
+            }
+            else{
+                const unsigned char byte=byteAt(bytes, depth+matched);
+                addSorted(parent.get(), byte, fresh.release());
+                if(byte<innerByte)
+                    linkBefore(leaf, minLeaf(inner));
+                else
+                    linkAfter(leaf, maxLeaf(inner));
+            }
+            *ref=parent.release();
+            break;
+        }
+        depth+=matched;
+        if(depth==bytes.size()){
+            //key is a proper prefix of the keys below, it comes before all of them
+            inner->terminal=fresh.release();
+            linkBefore(leaf, minLeaf(firstChild(inner)));
+            break;
+        }
+        const unsigned char byte=byteAt(bytes, depth);
+        Node** child=findChild(inner, byte);
+        if(child==nullptr){
+            //the neighbour is in a sibling subtree, an inner node has at least two entries
+            Node* greater=childAfter(inner, byte);
+            Node* smaller=greater==nullptr ? childBefore(inner, byte) : nullptr;
+            Leaf* terminal=inner->terminal;
+            addChild(*ref, byte, leaf);//may replace inner
+            fresh.release();
+            if(greater!=nullptr)
+                linkBefore(leaf, minLeaf(greater));
+            else
+                linkAfter(leaf, smaller!=nullptr ? maxLeaf(smaller) : terminal);
+            break;
+        }
+        ref=child;
+        depth+=1;
+    }
+    ++size;
+    return leaf;
+  }
+
+  static std::string prefixOf(const Bytes& bytes, std::size_t from, std::size_t to)
+  {
+    return std::string(reinterpret_cast<const char*>(bytes.data())+from, to-from);
+  }
+
+  //puts a leaf under a new parent whose path ends at depth
+  static void place(Node4* parent, Leaf* leaf, const Bytes& bytes, std::size_t depth)
+  {
+    if(depth==bytes.size())
+        parent->terminal=leaf;
+    else
+        addSorted(parent, byteAt(bytes, depth), leaf);
+  }
+
+  void linkBefore(Leaf* leaf, Leaf* next)
+  {
+    leaf->next=next;
+    leaf->prev=next->prev;
+    if(next->prev!=nullptr)
+        next->prev->next=leaf;
+    else
+        leftmost=leaf;
+    next->prev=leaf;
+  }
+
+  void linkAfter(Leaf* leaf, Leaf* prev)
+  {
+    leaf->prev=prev;
+    leaf->next=prev->next;
+    if(prev->next!=nullptr)
+        prev->next->prev=leaf;
+    else
+        rightmost=leaf;
+    prev->next=leaf;
+  }
+
+  void unlink(Leaf* leaf)
+  {
+    if(leaf->prev!=nullptr)
+        leaf->prev->next=leaf->next;
+    else
+        leftmost=leaf->next;
+    if(leaf->next!=nullptr)
+        leaf->next->prev=leaf->prev;
+    else
+        rightmost=leaf->prev;
+  }
+
+  bool removeLeaf(const key_type& key)
+  {
+    const Bytes bytes=Traits::bytes(key);
+    Node** parentRef=nullptr;
+    Node** ref=&root;
+    std::size_t depth=0;
+    while(*ref!=nullptr){
+        Node* node=*ref;
+        if(node->type==LEAF){
+            Leaf* leaf=static_cast<Leaf*>(node);
+            if(compareBytes(bytesOf(leaf), bytes)!=0)
+                return false;
+            if(parentRef==nullptr)
+                *ref=nullptr;
+            else
+                removeChild(*parentRef, byteAt(bytes, depth-1));
+            dropLeaf(leaf);
+            return true;
+        }
+        Inner* inner=static_cast<Inner*>(node);
+        const std::size_t length=inner->prefix.size();
+        if(bytes.size()-depth<length
+           || std::memcmp(inner->prefix.data(), bytes.data()+depth, length)!=0)
+            return false;
+        depth+=length;
+        if(depth==bytes.size()){
+            Leaf* leaf=inner->terminal;
+            if(leaf==nullptr)
+                return false;
+            inner->terminal=nullptr;
+            collapse(*ref);
+            dropLeaf(leaf);
+            return true;
+        }
+        Node** child=findChild(inner, byteAt(bytes, depth));
+        if(child==nullptr)
+            return false;
+        parentRef=ref;
+        ref=child;
+        ++depth;
+    }
+    return false;
+  }
+
+  void dropLeaf(Leaf* leaf)
+  {
+    unlink(leaf);
+    delete leaf;
+    --size;
+  }
+
+  //replaces an inner node left with a single entry by that entry
+  static void collapse(Node*& ref)
+  {
+    Inner* inner=static_cast<Inner*>(ref);
+    if(inner->count==0){
+        ref=inner->terminal;
+        inner->terminal=nullptr;
+        delete static_cast<Node4*>(inner);
+    }
+    else if(inner->count==1 && inner->terminal==nullptr && inner->type==NODE4){
+        Node4* node=static_cast<Node4*>(inner);
+        Node* child=node->children[0];
+        if(child->type!=LEAF){
+            Inner* below=static_cast<Inner*>(child);
+            below->prefix=node->prefix+static_cast<char>(node->keys[0])+below->prefix;
+        }
+        ref=child;
+        delete node;
+    }
+  }
+
+  static Leaf* minLeaf(const Node* node)
+  {
+    while(node->type!=LEAF){
+        const Inner* inner=static_cast<const Inner*>(node);
+        if(inner->terminal!=nullptr)
+            return inner->terminal;
+        node=firstChild(inner);
+    }
+    return const_cast<Leaf*>(static_cast<const Leaf*>(node));
+  }
+
+  static Leaf* maxLeaf(const Node* node)
+  {
+    while(node->type!=LEAF){
+        const Inner* inner=static_cast<const Inner*>(node);
+        if(inner->count==0)
+            return inner->terminal;
+        node=childBefore(inner, 256);
+    }
+    return const_cast<Leaf*>(static_cast<const Leaf*>(node));
+  }
+
+  static Node* firstChild(const Inner* inner)
+  {
+    return childAfter(inner, -1);
+  }
+
+  static Node** findChild(Inner* inner, unsigned char byte)
+  {
+    return const_cast<Node**>(findChild(static_cast<const Inner*>(inner), byte));
+  }
+
+  static Node* const* findChild(const Inner* inner, unsigned char byte)
+  {
+    switch(inner->type){
+    case NODE4:{
+        const Node4* node=static_cast<const Node4*>(inner);
+        for (unsigned i=0; i<node->count; ++i)
+            if(node->keys[i]==byte)
+                return &node->children[i];
+        return nullptr;
+    }
+    case NODE16:{
+        const Node16* node=static_cast<const Node16*>(inner);
+#if defined(__SSE2__)
+        //all 16 keys are compared at once
+        const __m128i keys=_mm_loadu_si128(reinterpret_cast<const __m128i*>(node->keys));
+        const unsigned mask=static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(byte))))) & ((1u << node->count)-1);
+        return mask!=0 ? &node->children[__builtin_ctz(mask)] : nullptr;
+#else
+        for (unsigned i=0; i<node->count; ++i)
+            if(node->keys[i]==byte)
+                return &node->children[i];
+        return nullptr;
+#endif
+    }
+    case NODE48:{
+        const Node48* node=static_cast<const Node48*>(inner);
+        const unsigned slot=node->index[byte];
+        return slot!=0 ? &node->children[slot-1] : nullptr;
+    }
+    default:{
+        const Node256* node=static_cast<const Node256*>(inner);
+        return node->children[byte]!=nullptr ? &node->children[byte] : nullptr;
+    }
+    }
+  }
+
+  //the child with the smallest byte greater than byte, nullptr if there is none
+  static Node* childAfter(const Inner* inner, int byte)
+  {
+    switch(inner->type){
+    case NODE4:
+        return sortedChildAfter(static_cast<const Node4*>(inner), byte);
+    case NODE16:
+        return sortedChildAfter(static_cast<const Node16*>(inner), byte);
+    case NODE48:{
+        const Node48* node=static_cast<const Node48*>(inner);
+        for (int i=byte+1; i<256; ++i)
+            if(node->index[i]!=0)
+                return node->children[node->index[i]-1];
+        return nullptr;
+    }
+    default:{
+        const Node256* node=static_cast<const Node256*>(inner);
+        for (int i=byte+1; i<256; ++i)
+            if(node->children[i]!=nullptr)
+                return node->children[i];
+        return nullptr;
+    }
+    }
+  }
+
+  //the child with the greatest byte smaller than byte, nullptr if there is none
+  static Node* childBefore(const Inner* inner, int byte)
+  {
+    switch(inner->type){
+    case NODE4:
+        return sortedChildBefore(static_cast<const Node4*>(inner), byte);
+    case NODE16:
+        return sortedChildBefore(static_cast<const Node16*>(inner), byte);
+    case NODE48:{
+        const Node48* node=static_cast<const Node48*>(inner);
+        for (int i=byte-1; i>=0; --i)
+            if(node->index[i]!=0)
+                return node->children[node->index[i]-1];
+        return nullptr;
+    }
+    default:{
+        const Node256* node=static_cast<const Node256*>(inner);
+        for (int i=byte-1; i>=0; --i)
+            if(node->children[i]!=nullptr)
+                return node->children[i];
+        return nullptr;
+    }
+    }
+  }
+
+  template <typename Sorted>
+  static Node* sortedChildAfter(const Sorted* node, int byte)
+  {
+    for (unsigned i=0; i<node->count; ++i)
+        if(node->keys[i]>byte)
+            return node->children[i];
+    return nullptr;
+  }
+
+  template <typename Sorted>
+  static Node* sortedChildBefore(const Sorted* node, int byte)
+  {
+    for (unsigned i=node->count; i-->0; )
+        if(node->keys[i]<byte)
+            return node->children[i];
+    return nullptr;
+  }
+
+  //Node4 and Node16 keep their keys sorted
+  template <typename Sorted>
+  static void addSorted(Sorted* node, unsigned char byte, Node* child)
+  {
+    unsigned i=node->count;
+    for (; i>0 && node->keys[i-1]>byte; --i){
+        node->keys[i]=node->keys[i-1];
+        node->children[i]=node->children[i-1];
+    }
+    node->keys[i]=byte;
+    node->children[i]=child;
+    ++node->count;
+  }
+
+  template <typename Sorted>
+  static void removeSorted(Sorted* node, unsigned char byte)
+  {
+    unsigned i=0;
+    while(node->keys[i]!=byte)
+        ++i;
+    for (--node->count; i<node->count; ++i){
+        node->keys[i]=node->keys[i+1];
+        node->children[i]=node->children[i+1];
+    }
+  }
+
+  //adds a child to the inner node at ref, which is replaced by a bigger one when full
+  static void addChild(Node*& ref, unsigned char byte, Node* child)
+  {
+    Inner* inner=static_cast<Inner*>(ref);
+    switch(inner->type){
+    case NODE4:{
+        Node4* node=static_cast<Node4*>(inner);
+        if(node->count<4){
+            addSorted(node, byte, child);
+            return;
+        }
+        Node16* bigger=new Node16(std::move(*node));
+        std::copy(node->keys, node->keys+4, bigger->keys);
+        std::copy(node->children, node->children+4, bigger->children);
+        addSorted(bigger, byte, child);
+        ref=bigger;
+        delete node;
+        return;
+    }
+    case NODE16:{
+        Node16* node=static_cast<Node16*>(inner);
+        if(node->count<16){
+            addSorted(node, byte, child);
+            return;
+        }
+        Node48* bigger=new Node48(std::move(*node));
+        for (unsigned i=0; i<16; ++i){
+            bigger->children[i]=node->children[i];
+            bigger->index[node->keys[i]]=static_cast<unsigned char>(i+1);
+        }
+        addToNode48(bigger, byte, child);
+        ref=bigger;
+        delete node;
+        return;
+    }
+    case NODE48:{
+        Node48* node=static_cast<Node48*>(inner);
+        if(node->count<48){
+            addToNode48(node, byte, child);
+            return;
+        }
+        Node256* bigger=new Node256(std::move(*node));
+        for (unsigned i=0; i<256; ++i)
+            if(node->index[i]!=0)
+                bigger->children[i]=node->children[node->index[i]-1];
+        bigger->children[byte]=child;
+        ++bigger->count;
+        ref=bigger;
+        delete node;
+        return;
+    }
+    default:{
+        Node256* node=static_cast<Node256*>(inner);
+        node->children[byte]=child;
+        ++node->count;
+    }
+    }
+  }
+
+  static void addToNode48(Node48* node, unsigned char byte, Node* child)
+  {
+    unsigned slot=0;
+    while(node->children[slot]!=nullptr)
+        ++slot;
+    node->children[slot]=child;
+    node->index[byte]=static_cast<unsigned char>(slot+1);
+    ++node->count;
+  }
+
+  //removes a child of the inner node at ref, which is replaced by a smaller one, or by its
+  //only remaining entry, when it gets sparse enough
+  static void removeChild(Node*& ref, unsigned char byte)
+  {
+    Inner* inner=static_cast<Inner*>(ref);
+    switch(inner->type){
+    case NODE4:
+        removeSorted(static_cast<Node4*>(inner), byte);
+        collapse(ref);
+        return;
+    case NODE16:{
+        Node16* node=static_cast<Node16*>(inner);
+        removeSorted(node, byte);
+        if(node->count>3)
+            return;
+        Node4* smaller=new Node4(std::move(*node));
+        std::copy(node->keys, node->keys+node->count, smaller->keys);
+        std::copy(node->children, node->children+node->count, smaller->children);
+        ref=smaller;
+        delete node;
+        return;
+    }
+    case NODE48:{
+        Node48* node=static_cast<Node48*>(inner);
+        node->children[node->index[byte]-1]=nullptr;
+        node->index[byte]=0;
+        --node->count;
+        if(node->count>12)
+            return;
+        Node16* smaller=new Node16(std::move(*node));
+        smaller->count=0;
+        for (unsigned i=0; i<256; ++i)
+            if(node->index[i]!=0)
+                addSorted(smaller, static_cast<unsigned char>(i), node->children[node->index[i]-1]);
+        ref=smaller;
+        delete node;
+        return;
+    }
+    default:{
+        Node256* node=static_cast<Node256*>(inner);
+        node->children[byte]=nullptr;
+        --node->count;
+        if(node->count>37)
+            return;
+        Node48* smaller=new Node48(std::move(*node));
+        smaller->count=0;
+        for (unsigned i=0; i<256; ++i)
+            if(node->children[i]!=nullptr)
+                addToNode48(smaller, static_cast<unsigned char>(i), node->children[i]);
+        ref=smaller;
+        delete node;
+    }
+    }
+  }
+
+  //calls fn on every child in key order
+  template <typename F>
+  static void forEachChild(const Inner* inner, F fn)
+  {
+    switch(inner->type){
+    case NODE4:{
+        const Node4* node=static_cast<const Node4*>(inner);
+        for (unsigned i=0; i<node->count; ++i)
+            fn(node->keys[i], node->children[i]);
+        return;
+    }
+    case NODE16:{
+        const Node16* node=static_cast<const Node16*>(inner);
+        for (unsigned i=0; i<node->count; ++i)
+            fn(node->keys[i], node->children[i]);
+        return;
+    }
+    case NODE48:{
+        const Node48* node=static_cast<const Node48*>(inner);
+        for (unsigned i=0; i<256; ++i)
+            if(node->index[i]!=0)
+                fn(static_cast<unsigned char>(i), node->children[node->index[i]-1]);
+        return;
+    }
+    default:{
+        const Node256* node=static_cast<const Node256*>(inner);
+        for (unsigned i=0; i<256; ++i)
+            if(node->children[i]!=nullptr)
+                fn(static_cast<unsigned char>(i), node->children[i]);
+    }
+    }
+  }
+
+  //copies the subtree in key order, appending its leaves to the list ending at last
+  Node* cloneNode(const Node* node, Leaf*& last)
+  {
+    if(node==nullptr)
+        return nullptr;
+    if(node->type==LEAF){
+        Leaf* leaf=new Leaf(static_cast<const Leaf*>(node)->pair);
+        leaf->prev=last;
+        if(last!=nullptr)
+            last->next=leaf;
+        else
+            leftmost=leaf;
+        last=leaf;
+        return leaf;
+    }
+    const Inner* inner=static_cast<const Inner*>(node);
+    Node* result=new Node4(inner->prefix);
+    try{
+        if(inner->terminal!=nullptr)
+            static_cast<Inner*>(result)->terminal=static_cast<Leaf*>(cloneNode(inner->terminal, last));
+        forEachChild(inner, [&](unsigned char byte, const Node* child) {
+            Node* clone=cloneNode(child, last);
+            try{
+                addChild(result, byte, clone);//grows the copy to the size of inner
+            }
+            catch(...){
+                deleteInners(clone);
+                throw;
+            }
+        });
+    }
+    catch(...){
+        //leaves are freed from the list by the caller
+        deleteInners(result);
+        throw;
+    }
+    return result;
+  }
+
+  //frees the inner nodes of a subtree, but not its leaves
+  static void deleteInners(Node* node)
+  {
+    if(node==nullptr || node->type==LEAF)
+        return;
+    Inner* inner=static_cast<Inner*>(node);
+    forEachChild(inner, [](unsigned char, Node* child) { deleteInners(child); });
+    deleteInner(inner);
+  }
+
+  static void deleteNode(Node* node)
+  {
+    if(node==nullptr)
+        return;
+    if(node->type==LEAF){
+        delete static_cast<Leaf*>(node);
+        return;
+    }
+    Inner* inner=static_cast<Inner*>(node);
+    delete inner->terminal;
+    forEachChild(inner, [](unsigned char, Node* child) { deleteNode(child); });
+    deleteInner(inner);
+  }
+
+  static void deleteInner(Inner* inner)
+  {
+    switch(inner->type){
+    case NODE4:
+        delete static_cast<Node4*>(inner);
+        return;
+    case NODE16:
+        delete static_cast<Node16*>(inner);
+        return;
+    case NODE48:
+        delete static_cast<Node48*>(inner);
+        return;
+    default:
+        delete static_cast<Node256*>(inner);
+    }
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Node
+{
+    friend class RadixTreeMap;
+protected:
+    const NodeType type;
+
+    explicit Node(NodeType pType): type(pType)
+    {}
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Leaf : public RadixTreeMap<KeyType, ValueType>::Node
+{
+    friend class RadixTreeMap;
+    friend class ConstIterator;
+    value_type pair;
+    Leaf* prev=nullptr;//in-order predecessor, nullptr for the first leaf
+    Leaf* next=nullptr;//in-order successor, nullptr for the last leaf
+public:
+    explicit Leaf(value_type pPair): Node(LEAF), pair(std::move(pPair))
+    {}
+};
+
+//the bytes of the compressed path are stored whole, so a lookup never has to check a leaf
+//for the skipped ones; terminal holds the key that ends right after the prefix, which
+//only keys of varying length can do
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Inner : public RadixTreeMap<KeyType, ValueType>::Node
+{
+    friend class RadixTreeMap;
+protected:
+    std::uint16_t count=0;//number of children
+    Leaf* terminal=nullptr;
+    std::string prefix;
+
+    Inner(NodeType pType, std::string pPrefix): Node(pType), prefix(std::move(pPrefix))
+    {}
+
+    //takes over the header of a node that grows or shrinks
+    Inner(NodeType pType, Inner&& other)
+        : Node(pType), count(other.count), terminal(other.terminal), prefix(std::move(other.prefix))
+    {}
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Node4 : public RadixTreeMap<KeyType, ValueType>::Inner
+{
+    friend class RadixTreeMap;
+    unsigned char keys[4];
+    Node* children[4];
+public:
+    explicit Node4(std::string pPrefix): Inner(NODE4, std::move(pPrefix))
+    {}
+
+    explicit Node4(Inner&& other): Inner(NODE4, std::move(other))
+    {}
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Node16 : public RadixTreeMap<KeyType, ValueType>::Inner
+{
+    friend class RadixTreeMap;
+    unsigned char keys[16];
+    Node* children[16];
+public:
+    explicit Node16(Inner&& other): Inner(NODE16, std::move(other))
+    {}
+};
+
+//index maps a byte to its child's slot plus one, 0 means no child
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Node48 : public RadixTreeMap<KeyType, ValueType>::Inner
+{
+    friend class RadixTreeMap;
+    unsigned char index[256]={};
+    Node* children[48]={};
+public:
+    explicit Node48(Inner&& other): Inner(NODE48, std::move(other))
+    {}
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Node256 : public RadixTreeMap<KeyType, ValueType>::Inner
+{
+    friend class RadixTreeMap;
+    Node* children[256]={};
+public:
+    explicit Node256(Inner&& other): Inner(NODE256, std::move(other))
+    {}
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::ConstIterator
+{
+    friend class RadixTreeMap;
+protected:
+    const RadixTreeMap* tree;
+    Leaf* current;
+public:
+  using reference = typename RadixTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename RadixTreeMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename RadixTreeMap::value_type*;
+
+  explicit ConstIterator(const RadixTreeMap& pTree, Leaf* leaf): tree(&pTree), current(leaf)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(current==nullptr)
+        throw std::out_of_range("can not increment the end");
+    current=current->next;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(tree->isEmpty())
+        throw std::out_of_range("can not decrement iterator of empty collection");
+    if(current==nullptr){
+        current=tree->rightmost;
+        return *this;
+    }
+    if(current->prev==nullptr)
+        throw std::out_of_range("can not decrement begin");
+    current=current->prev;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(current==nullptr)
+        throw std::out_of_range("can not refer iterator of end");
+    return current->pair;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return current==other.current;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class RadixTreeMap<KeyType, ValueType>::Iterator : public RadixTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename RadixTreeMap::reference;
+  using pointer = typename RadixTreeMap::value_type*;
+
+  explicit Iterator(const RadixTreeMap& tree, Leaf* leaf): ConstIterator(tree, leaf)
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_RADIXTREEMAP_H */
@@ -0,0 +1,555 @@
+#ifndef AISDI_MAPS_SKIPLISTMAP_H
+#define AISDI_MAPS_SKIPLISTMAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Epochs.h"
+#include "KeyTraits.h"
+
+namespace aisdi
+{
+
+//an ordered map for concurrent use: lookups, upserts, removals and iteration run on any
+//number of threads without locks. It is the lock-free skip list of Herlihy and Shavit: a
+//removed node is first marked, in the low bit of its next pointers, and then unlinked by
+//whichever thread passes it; unlinked nodes and replaced values are freed by epoch-based
+//reclamation once no thread can be reading them any more.
+//Values are copied out, never referenced, and iteration is weakly consistent: it sees the
+//items present for its whole walk and maybe some inserted or removed meanwhile. Iterators
+//pin an epoch, so they must not outlive the map nor move to another thread.
+template <typename KeyType, typename ValueType, typename Compare = DefaultCompare<KeyType>>
+class SkipListMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using key_compare = Compare;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = const value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  class Node;
+  class Guard;
+
+  static const int MAX_LEVEL=16;//levels grow with probability 1/4, enough for 4^16 items
+
+  Compare compare;//keys are equal when neither is less than the other
+  Epochs epochs;
+  Node* head;//sentinel of height MAX_LEVEL, its key is never compared
+  std::atomic<size_type> size;
+
+public:
+  SkipListMap(): head(new Node(key_type(), nullptr, MAX_LEVEL)), size(0)
+  {}
+
+  explicit SkipListMap(const Compare& pCompare): compare(pCompare), head(new Node(key_type(), nullptr, MAX_LEVEL)), size(0)
+  {}
+
+  SkipListMap(std::initializer_list<value_type> list, const Compare& pCompare=Compare())
+    : SkipListMap(list.begin(), list.end(), pCompare)
+  {}
+
+  //for repeated keys the last value wins
+  template <typename InputIt>
+  SkipListMap(InputIt first, InputIt last, const Compare& pCompare=Compare()): SkipListMap(pCompare)
+  {
+    for (; first!=last; ++first)
+        upsert(first->first, first->second);
+  }
+
+  SkipListMap(const SkipListMap&) = delete;
+  SkipListMap& operator=(const SkipListMap&) = delete;
+
+  ~SkipListMap()
+  {
+    Node* node=head;
+    while(node!=nullptr){
+        Node* next=pointer(node->next[0].load(std::memory_order_relaxed));
+        delete node;
+        node=next;
+    }
+  }
+
+  bool isEmpty() const
+  {
+    return getSize()==0;
+  }
+
+  //exact when no update is in flight
+  size_type getSize() const
+  {
+    return size.load(std::memory_order_relaxed);
+  }
+
+  key_compare key_comp() const
+  {
+    return compare;
+  }
+
+  //inserts key with value or replaces the value it has, returns true when key was inserted
+  bool upsert(const key_type& key, const mapped_type& value)
+  {
+    Guard guard(epochs);
+    std::unique_ptr<mapped_type> fresh(new mapped_type(value));
+    while(true){
+        Node* node=insertOrFind(guard, key, fresh.get());
+        if(node==nullptr){
+            fresh.release();
+            return true;
+        }
+        if(marked(node->next[0].load(std::memory_order_acquire)))
+            continue;
+        guard.retire(node->value.exchange(fresh.release(), std::memory_order_acq_rel));
+        return false;
+    }
+  }
+
+  //calls fn on a copy of the value of key and stores the result, or inserts init if key
+  //is missing; fn may run more than once when other threads update the same key
+  template <typename F>
+  void upsert(const key_type& key, const mapped_type& init, F fn)
+  {
+    Guard guard(epochs);
+    while(true){
+        Node* node=findNode(key);
+        if(node==nullptr){
+            std::unique_ptr<mapped_type> fresh(new mapped_type(init));
+            node=insertOrFind(guard, key, fresh.get());
+            if(node==nullptr){
+                fresh.release();
+                return;
+            }
+        }
+        mapped_type* current=node->value.load(std::memory_order_acquire);
+        std::unique_ptr<mapped_type> updated(new mapped_type(*current));
+        fn(*updated);
+        if(marked(node->next[0].load(std::memory_order_acquire)))
+            continue;
+        if(node->value.compare_exchange_strong(current, updated.get(), std::memory_order_acq_rel)){
+            updated.release();
+            guard.retire(current);
+            return;
+        }
+    }
+  }
+
+  //a copy of the value of key, throws std::out_of_range if there is no such key
+  mapped_type valueOf(const key_type& key) const
+  {
+    Guard guard(epochs);
+    const Node* node=findNode(key);
+    if (node == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return *node->value.load(std::memory_order_acquire);
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    Guard guard(epochs);
+    return ConstIterator(guard, findNode(key));
+  }
+
+  //the first item with a key not smaller than key
+  const_iterator lower_bound(const key_type& key) const
+  {
+    Guard guard(epochs);
+    return ConstIterator(guard, firstNotBefore(key));
+  }
+
+  //removes key, returns how many items were removed: 0 or 1
+  size_type erase(const key_type& key)
+  {
+    Guard guard(epochs);
+    Node* preds[MAX_LEVEL];
+    Node* succs[MAX_LEVEL];
+    if(!findNeighbours(key, preds, succs))
+        return 0;
+    Node* node=succs[0];
+    for (int level=node->height-1; level>0; --level) {
+        std::uintptr_t succ=node->next[level].load(std::memory_order_acquire);
+        while(!marked(succ))
+            node->next[level].compare_exchange_weak(succ, succ|1, std::memory_order_acq_rel);
+    }
+    //marking the bottom level is the removal, whoever does it first removes the item
+    std::uintptr_t succ=node->next[0].load(std::memory_order_acquire);
+    do{
+        if(marked(succ))
+            return 0;
+    }while(!node->next[0].compare_exchange_weak(succ, succ|1, std::memory_order_acq_rel));
+    size.fetch_sub(1, std::memory_order_relaxed);
+    release(guard, node);
+    return 1;
+  }
+
+  void remove(const key_type& key)
+  {
+    if(erase(key)==0)
+        throw std::out_of_range("can not remove key that not exist in tree");
+  }
+
+  const_iterator cbegin() const
+  {
+    Guard guard(epochs);
+    return ConstIterator(guard, nextPresent(head));
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator();
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+
+private:
+  static Node* pointer(std::uintptr_t link)
+  {
+    return reinterpret_cast<Node*>(link & ~std::uintptr_t(1));
+  }
+
+  static bool marked(std::uintptr_t link)
+  {
+    return (link & 1)!=0;
+  }
+
+  static std::uintptr_t linkTo(const Node* node)
+  {
+    return reinterpret_cast<std::uintptr_t>(node);
+  }
+
+  //the last node on level before key, starting from node, and in next the first one after
+  //it that is not removed; marked nodes are stepped over, which is safe while the epoch is
+  //pinned: a marked node's links are frozen and lead to nodes that were unlinked after it
+  Node* lastBefore(Node* node, const key_type& key, int level, Node*& next) const
+  {
+    Node* curr=pointer(node->next[level].load(std::memory_order_acquire));
+    while(curr!=nullptr){
+        const std::uintptr_t succ=curr->next[level].load(std::memory_order_acquire);
+        if(!marked(succ)){
+            if(!compare(curr->key, key))
+                break;
+            node=curr;
+        }
+        curr=pointer(succ);
+    }
+    next=curr;
+    return node;
+  }
+
+  //the first present node with a key not smaller than key; it is the one the bottom level
+  //walk stopped at, as the link after its predecessor may already lead to a newer node
+  Node* firstNotBefore(const key_type& key) const
+  {
+    Node* node=head;
+    Node* next=nullptr;
+    for (int level=MAX_LEVEL-1; level>=0; --level)
+        node=lastBefore(node, key, level, next);
+    return next;
+  }
+
+  //the first node after node that is not removed
+  static Node* nextPresent(const Node* node)
+  {
+    Node* next=pointer(node->next[0].load(std::memory_order_acquire));
+    while(next!=nullptr && marked(next->next[0].load(std::memory_order_acquire)))
+        next=pointer(next->next[0].load(std::memory_order_acquire));
+    return next;
+  }
+
+  Node* findNode(const key_type& key) const
+  {
+    Node* node=firstNotBefore(key);
+    return node!=nullptr && !compare(key, node->key) ? node : nullptr;
+  }
+
+  //fills preds and succs with the neighbours of key on every level and unlinks the marked
+  //nodes it passes, returns true if succs[0] holds key
+  bool findNeighbours(const key_type& key, Node** preds, Node** succs) const
+  {
+    while(!tryFindNeighbours(key, preds, succs))
+        ;
+    return succs[0]!=nullptr && !compare(key, succs[0]->key);
+  }
+
+  //false if unlinking a marked node failed, the search must then restart from the top
+  bool tryFindNeighbours(const key_type& key, Node** preds, Node** succs) const
+  {
+    Node* pred=head;
+    for (int level=MAX_LEVEL-1; level>=0; --level) {
+        Node* curr=pointer(pred->next[level].load(std::memory_order_acquire));
+        while(curr!=nullptr){
+            const std::uintptr_t succ=curr->next[level].load(std::memory_order_acquire);
+            if(marked(succ)){
+                std::uintptr_t expected=linkTo(curr);
+                if(!pred->next[level].compare_exchange_strong(expected, succ & ~std::uintptr_t(1),
+                                                              std::memory_order_acq_rel))
+                    return false;
+                curr=pointer(succ);
+                continue;
+            }
+            if(!compare(curr->key, key))
+                break;
+            pred=curr;
+            curr=pointer(succ);
+        }
+        preds[level]=pred;
+        succs[level]=curr;
+    }
+    return true;
+  }
+
+  //links a new node holding value, or returns the node that already holds key;
+  //the new node is linked at the bottom level first, which makes it present
+  Node* insertOrFind(Guard& guard, const key_type& key, mapped_type* value)
+  {
+    Node* preds[MAX_LEVEL];
+    Node* succs[MAX_LEVEL];
+    std::unique_ptr<Node> node;
+    while(true){
+        if(findNeighbours(key, preds, succs)){
+            if(node!=nullptr)
+                node->value.store(nullptr, std::memory_order_relaxed);
+            return succs[0];
+        }
+        if(node==nullptr)
+            node.reset(new Node(key, value, randomLevel()));
+        for (int level=0; level<node->height; ++level)
+            node->next[level].store(linkTo(succs[level]), std::memory_order_relaxed);
+        std::uintptr_t expected=linkTo(succs[0]);
+        if(preds[0]->next[0].compare_exchange_strong(expected, linkTo(node.get()), std::memory_order_acq_rel))
+            break;
+    }
+    size.fetch_add(1, std::memory_order_relaxed);
+    Node* linked=node.release();
+    linkUpperLevels(linked, preds, succs);
+    release(guard, linked);
+    return nullptr;
+  }
+
+  //stops as soon as the node is marked: a removed node must not be linked any further
+  void linkUpperLevels(Node* node, Node** preds, Node** succs)
+  {
+    for (int level=1; level<node->height; ++level) {
+        while(true){
+            std::uintptr_t next=node->next[level].load(std::memory_order_acquire);
+            if(marked(next))
+                return;
+            //a failed search may have found other neighbours, so the node must not keep
+            //pointing at a successor that could be unlinked and freed meanwhile
+            if(pointer(next)!=succs[level]
+               && !node->next[level].compare_exchange_strong(next, linkTo(succs[level]), std::memory_order_acq_rel))
+                return;
+            std::uintptr_t expected=linkTo(succs[level]);
+            if(preds[level]->next[level].compare_exchange_strong(expected, linkTo(node), std::memory_order_acq_rel))
+                break;
+            findNeighbours(node->key, preds, succs);
+        }
+    }
+  }
+
+  //both the inserting thread and the remover hold a node until they are done linking and
+  //unlinking it; the last one to let go, after unlinking any level the other may have
+  //linked late, retires it
+  void release(Guard& guard, Node* node)
+  {
+    if(marked(node->next[0].load(std::memory_order_acquire))){
+        Node* preds[MAX_LEVEL];
+        Node* succs[MAX_LEVEL];
+        findNeighbours(node->key, preds, succs);
+    }
+    if(node->owners.fetch_sub(1, std::memory_order_acq_rel)==1)
+        guard.retire(node);
+  }
+
+  static int randomLevel()
+  {
+      std::uint64_t x=threadRandom();
+      int level=1;
+      for (; level<MAX_LEVEL && (x & 3)==0; x>>=2)
+          ++level;
+      return level;
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class SkipListMap<KeyType, ValueType, Compare>::Node
+{
+    friend class SkipListMap;
+    const key_type key;
+    std::atomic<mapped_type*> value;
+    std::atomic<int> owners;//see release()
+    const int height;
+    std::unique_ptr<std::atomic<std::uintptr_t>[]> next;//marked in bit 0 when removed
+public:
+    Node(const key_type& pKey, mapped_type* pValue, int pHeight)
+        : key(pKey), value(pValue), owners(2), height(pHeight), next(new std::atomic<std::uintptr_t>[pHeight])
+    {
+        for (int level=0; level<height; ++level)
+            next[level].store(0, std::memory_order_relaxed);
+    }
+
+    ~Node()
+    {
+        delete value.load(std::memory_order_relaxed);
+    }
+};
+
+//keeps the calling thread's epoch pinned for its lifetime; copies pin it once more
+template <typename KeyType, typename ValueType, typename Compare>
+class SkipListMap<KeyType, ValueType, Compare>::Guard
+{
+  const Epochs* epochs;
+  Epochs::Record* record;
+
+public:
+  Guard(): epochs(nullptr), record(nullptr)
+  {}
+
+  explicit Guard(const Epochs& pEpochs): epochs(&pEpochs), record(pEpochs.pin())
+  {}
+
+  Guard(const Guard& other): epochs(other.epochs), record(other.epochs==nullptr ? nullptr : other.epochs->pin())
+  {}
+
+  Guard& operator=(Guard other)
+  {
+    std::swap(epochs, other.epochs);
+    std::swap(record, other.record);
+    return *this;
+  }
+
+  ~Guard()
+  {
+    if(epochs!=nullptr)
+        epochs->unpin(record);
+  }
+
+  void retire(Node* node)
+  {
+    epochs->retire(record, node, [](void* pointer) { delete static_cast<Node*>(pointer); });
+  }
+
+  void retire(mapped_type* value)
+  {
+    epochs->retire(record, value, [](void* pointer) { delete static_cast<mapped_type*>(pointer); });
+  }
+};
+
+//walks the bottom level; the item it points at is copied when it gets there, so it can be
+//read even after the item has been removed or updated
+template <typename KeyType, typename ValueType, typename Compare>
+class SkipListMap<KeyType, ValueType, Compare>::ConstIterator
+{
+  friend class SkipListMap;
+public:
+  using reference = typename SkipListMap::const_reference;
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename SkipListMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename SkipListMap::value_type*;
+
+private:
+  Guard guard;//end() needs none
+  Node* current;
+  std::optional<value_type> item;
+
+  ConstIterator(const Guard& pGuard, Node* node): guard(node==nullptr ? Guard() : pGuard), current(node)
+  {
+    load();
+  }
+
+public:
+  ConstIterator(): current(nullptr)
+  {}
+
+  ConstIterator(const ConstIterator& other): guard(other.guard), current(other.current)
+  {
+    if(other.item)
+        item.emplace(*other.item);
+  }
+
+  ConstIterator& operator=(const ConstIterator& other)
+  {
+    guard=other.guard;
+    current=other.current;
+    item.reset();
+    if(other.item)
+        item.emplace(*other.item);
+    return *this;
+  }
+
+  ConstIterator& operator++()
+  {
+    if(current==nullptr)
+        throw std::out_of_range("can not increase end");
+    current=SkipListMap::nextPresent(current);
+    load();
+    if(current==nullptr)
+        guard=Guard();
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    operator++();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(current==nullptr)
+        throw std::out_of_range("can not dereferent iterator of end");
+    return *item;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return current==other.current;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  void load()
+  {
+    item.reset();
+    if(current!=nullptr)
+        item.emplace(current->key, *current->value.load(std::memory_order_acquire));
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_SKIPLISTMAP_H */
@@ -0,0 +1,557 @@
+#ifndef AISDI_MAPS_SMALLMAP_H
+#define AISDI_MAPS_SMALLMAP_H
+
+#include <bitset>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "HashMap.h"
+#include "TreeMap.h"
+
+namespace aisdi
+{
+
+//a map of at most N items kept inline, in the map object itself, that turns into a Large
+//map (a TreeMap or a HashMap) when the (N+1)th item is added and stays one from then on.
+//Tiny maps so cost no allocation besides their items' own, and lookups scan a few slots
+//of one cache line or two. Inline items keep the order of Large: sorted by key_compare
+//if it has one, found by binary search, otherwise in insertion order, found by a linear
+//scan with key_equal. Inline items never move, but all iterators and references are
+//invalidated when the map is promoted
+template <typename Large, std::size_t N = 16>
+class SmallMap
+{
+  static_assert(N>0 && N<=255, "slots are indexed by unsigned char");
+
+public:
+  using key_type = typename Large::key_type;
+  using mapped_type = typename Large::mapped_type;
+  using value_type = typename Large::value_type;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  //how inline keys are told apart, and how the Large map is made to do the same
+  template <typename Map, typename=void>
+  struct Ordering
+  {
+    static const bool sorted=false;
+    using Equal = typename Map::key_equal;
+    Equal equal;
+
+    Map make() const
+    {
+      return Map();
+    }
+  };
+
+  template <typename Map>
+  struct Ordering<Map, std::void_t<typename Map::key_compare>>
+  {
+    static const bool sorted=true;
+    using Compare = typename Map::key_compare;
+    Compare compare;
+
+    Map make() const
+    {
+      return Map(compare);
+    }
+  };
+
+  static const bool SORTED=Ordering<Large>::sorted;
+
+  //raw storage for the inline items; slots[i] holds an item if used[i] is set
+  alignas(value_type) unsigned char slots[N*sizeof(value_type)];
+  std::bitset<N> used;
+  unsigned char order[N];//the used slots in iteration order
+  size_type count=0;//inline items
+  std::optional<Large> large;//set once promoted
+  Ordering<Large> ordering;//the comparator the Large map is made with
+
+public:
+  SmallMap()
+  {}
+
+  //a sorted map ordered by pCompare inline and after promotion alike
+  template <typename Map=Large>
+  explicit SmallMap(const typename Map::key_compare& pCompare)
+  {
+    ordering.compare=pCompare;
+  }
+
+  SmallMap(std::initializer_list<value_type> list)
+  {
+    try{
+        for (auto&& item : list)
+            (*this)[item.first]=item.second;
+    }
+    catch(...){
+        destroyInline();
+        throw;
+    }
+  }
+
+  SmallMap(const SmallMap& other): large(other.large), ordering(other.ordering)
+  {
+    try{
+        for (; count<other.count; ++count)
+            construct(count, other.slot(other.order[count]));
+    }
+    catch(...){
+        destroyInline();
+        throw;
+    }
+  }
+
+  SmallMap(SmallMap&& other): large(std::move(other.large)), ordering(other.ordering)
+  {
+    try{
+        for (; count<other.count; ++count)
+            construct(count, std::move(other.slot(other.order[count])));
+    }
+    catch(...){
+        destroyInline();
+        throw;
+    }
+    other.large.reset();
+    other.destroyInline();
+  }
+
+  SmallMap& operator=(const SmallMap& other)
+  {
+    if(this!=&other){
+        SmallMap copy(other);
+        *this=std::move(copy);
+    }
+    return *this;
+  }
+
+  SmallMap& operator=(SmallMap&& other)
+  {
+    if(this!=&other){
+        destroyInline();
+        large=std::move(other.large);
+        other.large.reset();
+        ordering=other.ordering;
+        for (; count<other.count; ++count)
+            construct(count, std::move(other.slot(other.order[count])));
+        other.destroyInline();
+    }
+    return *this;
+  }
+
+  ~SmallMap()
+  {
+    destroyInline();
+  }
+
+  bool isEmpty() const
+  {
+    return getSize()==0;
+  }
+
+  size_type getSize() const
+  {
+    return large ? large->getSize() : count;
+  }
+
+  //true while the items are kept inline
+  bool isInline() const
+  {
+    return !large;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    if(large)
+        return (*large)[key];
+    const size_type position=search(key);
+    if(found(position, key))
+        return slot(order[position]).second;
+    if(count==N){
+        promote();
+        return (*large)[key];
+    }
+    return insertAt(position, key).second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(large)
+        return static_cast<const Large&>(*large).valueOf(key);
+    const size_type position=search(key);
+    if(!found(position, key))
+        throw std::out_of_range("Key does not exists");
+    return slot(order[position]).second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    if(large)
+        return large->valueOf(key);
+    return const_cast<mapped_type&>(static_cast<const SmallMap*>(this)->valueOf(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    if(large)
+        return ConstIterator(*this, static_cast<const Large&>(*large).find(key));
+    const size_type position=search(key);
+    return ConstIterator(*this, found(position, key) ? position : count);
+  }
+
+  iterator find(const key_type& key)
+  {
+    if(large)
+        return Iterator(ConstIterator(*this, large->find(key)));
+    return Iterator(static_cast<const SmallMap*>(this)->find(key));
+  }
+
+  //the mutable iterator to the item of it; as with the Large maps, only a non-const map
+  //converts
+  iterator toIterator(const const_iterator& it)
+  {
+    return Iterator(it);
+  }
+
+  void remove(const key_type& key)
+  {
+    if(large){
+        large->remove(key);
+        return;
+    }
+    const size_type position=search(key);
+    if(!found(position, key))
+        throw std::out_of_range("can not remove key that not exist in tree");
+    removeAt(position);
+  }
+
+  //returns the iterator following the removed item
+  iterator remove(const const_iterator& it)
+  {
+    if (it == end())
+        throw std::out_of_range("Can not remove the end");
+    if(large)
+        return Iterator(ConstIterator(*this, large->remove(*it.largeIt)));
+    removeAt(it.position);
+    return Iterator(ConstIterator(*this, it.position));
+  }
+
+  bool operator==(const SmallMap& other) const
+  {
+    if(getSize()!=other.getSize())
+        return false;
+    if(large && other.large)
+        return *large==*other.large;
+    for (auto&& item : *this){
+        auto it=other.find(item.first);
+        if(it==other.end() || it->second!=item.second)
+            return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const SmallMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    if(large)
+        return Iterator(ConstIterator(*this, large->begin()));
+    return Iterator(ConstIterator(*this, 0));
+  }
+
+  iterator end()
+  {
+    if(large)
+        return Iterator(ConstIterator(*this, large->end()));
+    return Iterator(ConstIterator(*this, count));
+  }
+
+  const_iterator cbegin() const
+  {
+    if(large)
+        return ConstIterator(*this, static_cast<const Large&>(*large).begin());
+    return ConstIterator(*this, 0);
+  }
+
+  const_iterator cend() const
+  {
+    if(large)
+        return ConstIterator(*this, static_cast<const Large&>(*large).end());
+    return ConstIterator(*this, count);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+
+private:
+  value_type& slot(unsigned char index)
+  {
+    return *std::launder(reinterpret_cast<value_type*>(slots+index*sizeof(value_type)));
+  }
+
+  const value_type& slot(unsigned char index) const
+  {
+    return *std::launder(reinterpret_cast<const value_type*>(slots+index*sizeof(value_type)));
+  }
+
+  //the position of key in order, or where it would go: sorted maps binary search, the
+  //others scan and return count when key is missing
+  size_type search(const key_type& key) const
+  {
+    if constexpr (SORTED){
+        size_type low=0, high=count;
+        while(low<high){
+            const size_type middle=(low+high)/2;
+            if(ordering.compare(slot(order[middle]).first, key))
+                low=middle+1;
+            else
+                high=middle;
+        }
+        return low;
+    }
+    else{
+        size_type position=0;
+        while(position<count && !ordering.equal(slot(order[position]).first, key))
+            ++position;
+        return position;
+    }
+  }
+
+  bool found(size_type position, const key_type& key) const
+  {
+    if(position==count)
+        return false;
+    if constexpr (SORTED)
+        return !ordering.compare(key, slot(order[position]).first);
+    else
+        return true;
+  }
+
+  //puts a new item at position of order, into the first free slot
+  value_type& insertAt(size_type position, const key_type& key)
+  {
+    unsigned char free=0;
+    while(used[free])
+        ++free;
+    new (slots+free*sizeof(value_type)) value_type(key, mapped_type());
+    used.set(free);
+    for (size_type i=count; i>position; --i)
+        order[i]=order[i-1];
+    order[position]=free;
+    ++count;
+    return slot(free);
+  }
+
+  //appends an item to order, for building a map that is known to be in order
+  template <typename Item>
+  void construct(size_type position, Item&& item)
+  {
+    new (slots+position*sizeof(value_type)) value_type(std::forward<Item>(item));
+    used.set(position);
+    order[position]=static_cast<unsigned char>(position);
+  }
+
+  void removeAt(size_type position)
+  {
+    const unsigned char index=order[position];
+    slot(index).~value_type();
+    used.reset(index);
+    --count;
+    for (size_type i=position; i<count; ++i)
+        order[i]=order[i+1];
+  }
+
+  //moves the inline items into a new Large map; they stay inline if that fails
+  void promote()
+  {
+    Large bigger=ordering.make();
+    for (size_type i=0; i<count; ++i)
+        bigger[slot(order[i]).first]=slot(order[i]).second;
+    large.emplace(std::move(bigger));
+    destroyInline();
+  }
+
+  void destroyInline()
+  {
+    for (size_type i=0; i<count; ++i)
+        slot(order[i]).~value_type();
+    used.reset();
+    count=0;
+  }
+};
+
+//walks the inline items by their position in order, or the Large map with its iterator
+template <typename Large, std::size_t N>
+class SmallMap<Large, N>::ConstIterator
+{
+    friend class SmallMap;
+protected:
+    using LargeIterator = typename Large::const_iterator;
+
+    const SmallMap* map;
+    size_type position=0;
+    std::optional<LargeIterator> largeIt;
+
+    explicit ConstIterator(const SmallMap& pMap, size_type pPosition): map(&pMap), position(pPosition)
+    {}
+
+    explicit ConstIterator(const SmallMap& pMap, const LargeIterator& it): map(&pMap), largeIt(it)
+    {}
+
+public:
+  using reference = typename SmallMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename SmallMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename SmallMap::value_type*;
+
+  ConstIterator& operator++()
+  {
+    if(largeIt){
+        ++*largeIt;
+        return *this;
+    }
+    if(position==map->count)
+        throw std::out_of_range("can not increment the end");
+    ++position;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(largeIt){
+        --*largeIt;
+        return *this;
+    }
+    if(map->count==0)
+        throw std::out_of_range("can not decrement iterator of empty collection");
+    if(position==0)
+        throw std::out_of_range("can not decrement begin");
+    --position;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(largeIt)
+        return **largeIt;
+    if(position==map->count)
+        throw std::out_of_range("can not refer iterator of end");
+    return map->slot(map->order[position]);
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return position==other.position && largeIt==other.largeIt;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename Large, std::size_t N>
+class SmallMap<Large, N>::Iterator : public SmallMap<Large, N>::ConstIterator
+{
+public:
+  using reference = typename SmallMap::reference;
+  using pointer = typename SmallMap::value_type*;
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+
+private:
+  friend class SmallMap;
+
+  //for the map's own non-const members; the Large map is never shared with a snapshot,
+  //copies of a SmallMap copy it, so its const_iterator may be written through
+  explicit Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+};
+
+template <typename KeyType, typename ValueType, std::size_t N = 16>
+using SmallTreeMap = SmallMap<TreeMap<KeyType, ValueType>, N>;
+
+template <typename KeyType, typename ValueType, std::size_t N = 16>
+using SmallHashMap = SmallMap<HashMap<KeyType, ValueType>, N>;
+
+}
+
+#endif /* AISDI_MAPS_SMALLMAP_H */
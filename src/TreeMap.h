@@ -1,20 +1,66 @@
 #ifndef AISDI_MAPS_TREEMAP_H
 #define AISDI_MAPS_TREEMAP_H
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <initializer_list>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "KeyTraits.h"
 //jezeli rowny to po prawo
+//drzewo jest treapem: kazdy wezel ma losowy priorytet, rodzic ma priorytet nie mniejszy niz dzieci
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
+//three-way comparison through a less-than comparator: negative, zero or positive
+template <typename Compare, typename A, typename B>
+int threeWayCompare(const Compare& compare, const A& a, const B& b)
+{
+  return compare(a, b) ? -1 : compare(b, a) ? 1 : 0;
+}
+
+//one pass over the characters instead of two
+template <typename Char, typename Traits, typename Alloc>
+int threeWayCompare(const std::less<std::basic_string<Char, Traits, Alloc>>&,
+                    const std::basic_string<Char, Traits, Alloc>& a,
+                    const std::basic_string<Char, Traits, Alloc>& b)
+{
+  return a.compare(b);
+}
+
+//StringLess also takes std::string_view and const char*
+template <typename A, typename B>
+int threeWayCompare(const StringLess&, const A& a, const B& b)
+{
+  return std::string_view(a).compare(std::string_view(b));
+}
+
+//no branches for built-in keys
+template <typename Key>
+typename std::enable_if<std::is_arithmetic<Key>::value, int>::type
+threeWayCompare(const std::less<Key>&, const Key& a, const Key& b)
+{
+  return (b < a) - (a < b);
+}
+
+template <typename KeyType, typename ValueType, typename Compare = DefaultCompare<KeyType>>
 class TreeMap
 {
 public:
   using key_type = KeyType;
   using mapped_type = ValueType;
+  using key_compare = Compare;
   using value_type = std::pair<const key_type, mapped_type>;
   using size_type = std::size_t;
   using reference = value_type&;
@@ -28,54 +74,145 @@ public:
 
 private:
   Node* root=nullptr;
+  Node* leftmost=nullptr;//cached min, begin() and min() are O(1)
+  Node* rightmost=nullptr;//cached max, --end() and max() are O(1)
   int size=0;
+  Compare compare;//keys are equal when neither is less than the other
+  //number of maps sharing the tree: a snapshot shares it with its map until one of them
+  //modifies it, which then takes a private clone, so a snapshot is O(1). The counter is
+  //allocated by the first snapshot; null means the map is the tree's only owner
+  mutable std::atomic<std::atomic<size_type>*> owners{ nullptr };
+
+public:
+  struct FingerStats
+  {
+    size_type lookups=0;
+    size_type hits=0;//lookups that started below the root
+    size_type steps=0;//nodes visited on the way up and down
+  };
+
+private:
+  bool fingerSearch=false;
+  mutable Node* finger=nullptr;//last accessed node in finger search mode
+  mutable FingerStats fingerCounters;
 
 public:
 
   TreeMap()
   {}
 
-  TreeMap(std::initializer_list<value_type> list)
+  explicit TreeMap(const Compare& pCompare): compare(pCompare)
+  {}
+
+private:
+  struct Share {};
+
+  TreeMap(const TreeMap& other, Share) : root(other.root), leftmost(other.leftmost), rightmost(other.rightmost),
+                                         size(other.size), compare(other.compare), owners(other.share())
+  {}
+
+public:
+
+  TreeMap(std::initializer_list<value_type> list, const Compare& pCompare=Compare())
+    : TreeMap(list.begin(), list.end(), pCompare)
+  {}
+
+  //sorted input (or its sorted prefix) is built into a balanced tree in O(n),
+  //the rest is bulk loaded; for repeated keys the last value wins
+  template <typename InputIt>
+  TreeMap(InputIt first, InputIt last, const Compare& pCompare=Compare()): compare(pCompare)
   {
-    for (auto&& item: list)
-        insert(item);
+    try{
+        first=assignSorted(first, last);
+        if(first!=last)
+            insertBulk(first, last);
+    }
+    catch(...){
+        //the destructor does not run for a constructor that throws
+        releaseTree();
+        throw;
+    }
   }
 
-  TreeMap(const TreeMap& other)
+  //a deep copy, O(n); references and iterators into other stay its own
+  TreeMap(const TreeMap& other) : size(other.size), compare(other.compare)
   {
-    for (auto&& item: other)
-        insert(item);
+    Node* none=nullptr;
+    Node* last=nullptr;
+    root=leftmost=cloneSubtree(other.root, nullptr, last, none, none);
+    while(leftmost!=nullptr && leftmost->left!=nullptr)
+        leftmost=leftmost->left;
+    rightmost=last;
   }
 
-  TreeMap(TreeMap&& other)
+  //an O(1) copy sharing the tree with this map until either of them is modified, which
+  //then clones it for itself: a consistent view for readers while the map goes on changing.
+  //References and iterators into this map obtained before its first modification after
+  //the snapshot, including ones obtained before the snapshot, still point into the shared
+  //tree afterwards; writing through them, or passing them to remove, erase or insert,
+  //would change the snapshot, so they have to be obtained again
+  TreeMap snapshot() const
+  {
+    return TreeMap(*this, Share());
+  }
+
+  //builds a perfectly balanced tree in O(n), throws std::invalid_argument if keys are not ascending
+  template <typename InputIt>
+  static TreeMap fromSorted(InputIt first, InputIt last, const Compare& pCompare=Compare())
+  {
+    TreeMap map(pCompare);
+    if(map.assignSorted(first, last)!=last)
+        throw std::invalid_argument("input of fromSorted is not sorted");
+    return map;
+  }
+
+  //bulk load of unsorted input, see insertBulk
+  template <typename InputIt>
+  static TreeMap bulkLoad(InputIt first, InputIt last, unsigned threads=defaultThreads())
+  {
+    TreeMap map;
+    map.insertBulk(first, last, threads);
+    return map;
+  }
+
+  TreeMap(TreeMap&& other): compare(other.compare)
   {
-    Node*temp=root;
     root=other.root;
+    leftmost=other.leftmost;
+    rightmost=other.rightmost;
     size=other.size;
-    other.root=temp;
+    owners.store(other.owners.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+    other.root=nullptr;
+    other.leftmost=nullptr;
+    other.rightmost=nullptr;
     other.size=0;
+    other.finger=nullptr;
   }
 
   TreeMap& operator=(const TreeMap& other)
   {
-    if(*this==other)//jak sie bedsie sypac zmien na this==other
+    if(this==&other)
         return *this;
-    deleteTree(root);
-    for (auto&& item: other)
-        insert(item);
-    return *this;
-
+    TreeMap copy(other);
+    return *this=std::move(copy);
   }
 
   TreeMap& operator=(TreeMap&& other)
   {
-    if(*this==other)
+    if(this==&other)
         return *this;
-    deleteTree(root);
+    deleteTree();
+    compare=other.compare;
     root=other.root;
+    leftmost=other.leftmost;
+    rightmost=other.rightmost;
     size=other.size;
+    owners.store(other.owners.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
     other.root=nullptr;
+    other.leftmost=nullptr;
+    other.rightmost=nullptr;
     other.size=0;
+    other.finger=nullptr;
     return *this;
   }
 
@@ -86,7 +223,9 @@ public:
 
   mapped_type& operator[](const key_type& key)
   {
-    Node*temp=findNode(key);
+    unshare();
+    //a key greater than all others is appended without a lookup
+    Node*temp= rightmost!=nullptr && compare(rightmost->pair.first, key) ? nullptr : findNode(key);
     if(temp!=nullptr)
         return temp->pair.second;
     temp=insert(key);
@@ -103,6 +242,7 @@ public:
 
   mapped_type& valueOf(const key_type& key)
   {
+    unshare();
     Node* node = findNode(key);//!!albo tu constcast albo wyzej const temp=to
     if (node == nullptr)
         throw std::out_of_range("Key does not exists");
@@ -116,26 +256,118 @@ public:
 
   iterator find(const key_type& key)
   {
+    unshare();
     return Iterator(*this, findNode(key) );
   }
 
+  //the mutable iterator to the item of it, after unsharing the tree with its snapshots;
+  //only a non-const map converts, so a const map, e.g. a published snapshot, never changes
+  iterator toIterator(const const_iterator& it)
+  {
+    Node* node=it.current;
+    Node* none=nullptr;
+    unshare(node, none);
+    return iterator(*this, node);
+  }
+
   void remove(const key_type& key)
   {
+    unshare();
     Node* toRemove=findNode(key);
     if(toRemove==nullptr)
         throw std::out_of_range("can not remove key that not exist in tree");
-    if(toRemove==root)
-        deleteRoot();
-    else if(toRemove->parent->pair.first>toRemove->pair.first)
-        deleteLeftChild(toRemove);
-    else deleteRightChild(toRemove);
+    removeNode(toRemove);
+  }
+
+  //with a transparent Compare keys can be looked up by any type it compares with key_type
+  template <typename K, typename C=Compare, typename=typename C::is_transparent>
+  const mapped_type& valueOf(const K& key) const
+  {
+    Node* node = findNode(key);
+    if (node == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return node->pair.second;
+  }
+
+  template <typename K, typename C=Compare, typename=typename C::is_transparent>
+  mapped_type& valueOf(const K& key)
+  {
+    unshare();
+    Node* node = findNode(key);
+    if (node == nullptr)
+        throw std::out_of_range("Key does not exists");
+    return node->pair.second;
+  }
+
+  template <typename K, typename C=Compare, typename=typename C::is_transparent>
+  const_iterator find(const K& key) const
+  {
+    return ConstIterator(*this, findNode(key) );
   }
 
-  void remove(const const_iterator& it)
+  template <typename K, typename C=Compare, typename=typename C::is_transparent>
+  iterator find(const K& key)
+  {
+    unshare();
+    return Iterator(*this, findNode(key) );
+  }
+
+  template <typename K, typename C=Compare, typename=typename C::is_transparent,
+            typename=typename std::enable_if<!std::is_convertible<K, const_iterator>::value>::type>
+  void remove(const K& key)
+  {
+    unshare();
+    Node* toRemove=findNode(key);
+    if(toRemove==nullptr)
+        throw std::out_of_range("can not remove key that not exist in tree");
+    removeNode(toRemove);
+  }
+
+  //returns the iterator following the removed item
+  iterator remove(const const_iterator& it)
   {
     if (it == end())
         throw std::out_of_range("Can not remove the end");
-    remove(it->first);
+    Node* toRemove=it.current;
+    Node* none=nullptr;
+    unshare(toRemove, none);
+    Node* next=toRemove->next;
+    removeNode(toRemove);
+    return iterator(*this, next);
+  }
+
+  //removes the items in [first, last) by cutting them out of the tree with two splits
+  //and freeing them along the list: O(log n + k) for k removed items
+  iterator erase(const const_iterator& first, const const_iterator& last)
+  {
+    Node* firstNode=first.current;
+    Node* lastNode=last.current;
+    unshare(firstNode, lastNode);
+    if(firstNode==lastNode)
+        return iterator(*this, lastNode);
+    if(firstNode==nullptr)
+        throw std::out_of_range("Can not remove the end");
+    Subtree smaller, range, greater={ nullptr, nullptr, nullptr };
+    splitBefore(takeTree(), firstNode->pair.first, smaller, range);
+    if(lastNode!=nullptr)
+        splitBefore(range, lastNode->pair.first, range, greater);
+    deleteSubtree(range);
+    setTree(joinTrees(smaller, greater));
+    return iterator(*this, lastNode);
+  }
+
+  //removes the items with keys in [lo, hi), returns how many were removed
+  size_type eraseRange(const key_type& lo, const key_type& hi)
+  {
+    if(!compare(lo, hi))
+        return 0;
+    Subtree smaller, range, greater;
+    splitBefore(takeTree(), lo, smaller, range);
+    splitBefore(range, hi, range, greater);
+    const size_type removed=weightOf(range.root);
+    deleteSubtree(range);
+    setTree(joinTrees(smaller, greater));
+    return removed;
   }
 
   size_type getSize() const
@@ -143,13 +375,219 @@ public:
     return size;
   }
 
+  key_compare key_comp() const
+  {
+    return compare;
+  }
+
+  //in finger search mode lookups start at the last accessed node, climb to the lowest
+  //subtree that can hold the key and descend from there: O(log d) expected for rank
+  //distance d from the previous lookup; lookups then write to the map, also const ones,
+  //so such a map must not be shared by reader threads
+  void setFingerSearch(bool enabled)
+  {
+    fingerSearch=enabled;
+    finger=nullptr;
+  }
+
+  bool isFingerSearch() const
+  {
+    return fingerSearch;
+  }
+
+  const FingerStats& fingerStats() const
+  {
+    return fingerCounters;
+  }
+
+  void resetFingerStats()
+  {
+    fingerCounters=FingerStats();
+  }
+
+  //buffers the items, sorts them on up to `threads` threads and rebuilds a balanced tree
+  //of old and new items bottom-up, subtrees on separate threads: O(n + m log m);
+  //for repeated keys the last value wins, as with operator[]
+  template <typename InputIt>
+  void insertBulk(InputIt first, InputIt last, unsigned threads=defaultThreads())
+  {
+    std::vector<Item> buffer;
+    for (; first!=last; ++first)
+        buffer.emplace_back(first->first, first->second);
+    if(buffer.empty())
+        return;
+    unshare();
+    const unsigned depth=forkDepth(threads);
+    parallelSort(buffer.data(), buffer.data()+buffer.size(), depth);
+    buffer.erase(uniqueKeepLast(buffer.begin(), buffer.end()), buffer.end());
+    if(buffer.size()*8<getSize()){
+        //few new items: a full rebuild would cost more than separate inserts
+        for (auto&& item : buffer)
+            (*this)[item.first]=std::move(item.second);
+        return;
+    }
+
+    //merges the in-order list with the buffer; slots of new items stay empty
+    std::vector<Node*> nodes;
+    std::vector<std::pair<size_type, Item*>> newItems;
+    nodes.reserve(getSize()+buffer.size());
+    Node* node=leftmost;
+    for (auto&& item : buffer) {
+        while(node!=nullptr && compare(node->pair.first, item.first)){
+            nodes.push_back(node);
+            node=node->next;
+        }
+        if(node!=nullptr && !compare(item.first, node->pair.first)){
+            node->pair.second=std::move(item.second);
+            continue;
+        }
+        newItems.emplace_back(nodes.size(), &item);
+        nodes.push_back(nullptr);
+    }
+    for (; node!=nullptr; node=node->next)
+        nodes.push_back(node);
+
+    allocateNodes(nodes, newItems, threads);
+    buildBalanced(nodes.data(), nodes.data(), nodes.size(), nodes.size(), nullptr, depth);
+    root=nodes[nodes.size()/2];
+    leftmost=nodes.front();
+    rightmost=nodes.back();
+    size=nodes.size();
+  }
+
+  //set operations relink the nodes of both trees by split/join, with O(m log(n/m + 1))
+  //expected work for sizes m <= n; both halves of the recursion run in parallel.
+  //If the comparator throws, the exception is passed on and the map is left empty
+
+  //union, for keys present in both maps the value from other wins
+  void merge(TreeMap other, unsigned threads=defaultThreads())
+  {
+    setTree(unionOf(takeTree(), other.takeTree(), true, forkDepth(threads)));
+  }
+
+  //keeps the items whose keys are also in other
+  void intersect(TreeMap other, unsigned threads=defaultThreads())
+  {
+    setTree(intersectionOf(takeTree(), other.takeTree(), false, forkDepth(threads)));
+  }
+
+  //removes the items whose keys are in other
+  void difference(TreeMap other, unsigned threads=defaultThreads())
+  {
+    setTree(differenceOf(takeTree(), other.takeTree(), forkDepth(threads)));
+  }
+
+  //inserts before the hint, as std::map does; with a correct hint no search is needed and
+  //the insertion is O(1) expected apart from the weight updates on the path to the root,
+  //otherwise it falls back to a lookup; an item with the same key is left unchanged
+  iterator insert(const const_iterator& hint, const key_type& key, const mapped_type& value)
+  {
+    return emplace_hint(hint, key, value);
+  }
+
+  template <typename... Args>
+  iterator emplace_hint(const const_iterator& hint, Args&&... args)
+  {
+    value_type item(std::forward<Args>(args)...);
+    Node* next=hint.current;
+    Node* none=nullptr;
+    unshare(next, none);
+    Node* prev= next==nullptr ? rightmost : next->prev;
+    if(prev!=nullptr && !compare(prev->pair.first, item.first))
+        return iterator(*this, !compare(item.first, prev->pair.first) ? prev : findOrInsert(std::move(item)));
+    if(next!=nullptr && !compare(item.first, next->pair.first))
+        return iterator(*this, !compare(next->pair.first, item.first) ? next : findOrInsert(std::move(item)));
+    Node* node=new Node(std::move(item));
+    if(root==nullptr)
+        return iterator(*this, insertNode(node));
+    //prev has no right child whenever next has a left one
+    if(next!=nullptr && next->left==nullptr)
+        return iterator(*this, attachLeft(node, next));
+    return iterator(*this, attachRight(node, prev));
+  }
+
+  //moves the items out into two maps, with keys smaller than key and not smaller than key;
+  //nodes are relinked, not copied, O(log n)
+  std::pair<TreeMap, TreeMap> split(const key_type& key)
+  {
+    std::pair<TreeMap, TreeMap> parts{ TreeMap(compare), TreeMap(compare) };
+    Subtree left, right;
+    splitBefore(takeTree(), key, left, right);
+    parts.first.setTree(left);
+    parts.second.setTree(right);
+    return parts;
+  }
+
+  //concatenates two maps, all keys of left must be smaller than those of right, O(log n)
+  static TreeMap join(TreeMap&& left, TreeMap&& right)
+  {
+    if(left.root!=nullptr && right.root!=nullptr && !left.compare(left.rightmost->pair.first, right.leftmost->pair.first))
+        throw std::invalid_argument("key ranges of joined maps overlap");
+    TreeMap joined(left.compare);
+    joined.setTree(joinTrees(left.takeTree(), right.takeTree()));
+    return joined;
+  }
+
+  reference min()
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not get min of empty collection");
+    unshare();
+    return leftmost->pair;
+  }
+
+  const_reference min() const
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not get min of empty collection");
+    return leftmost->pair;
+  }
+
+  reference max()
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not get max of empty collection");
+    unshare();
+    return rightmost->pair;
+  }
+
+  const_reference max() const
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not get max of empty collection");
+    return rightmost->pair;
+  }
+
+  value_type popMin()
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not pop from empty collection");
+    unshare();
+    value_type popped(std::move(leftmost->pair));
+    removeNode(leftmost);
+    return popped;
+  }
+
+  value_type popMax()
+  {
+    if(isEmpty())
+        throw std::out_of_range("can not pop from empty collection");
+    unshare();
+    value_type popped(std::move(rightmost->pair));
+    removeNode(rightmost);
+    return popped;
+  }
+
   bool operator==(const TreeMap& other) const
   {
     if (size != other.size)
         return false;
-    for (auto&& item : other) {
-        Node* node = findNode(item.first);
-        if (node == nullptr || node->pair.second != item.second)
+    //both in-order sequences are walked in lockstep; keys are equal the way the
+    //comparator sees them, KeyType needs no operator==
+    for (Node *node = leftmost, *otherNode = other.leftmost; node != nullptr;
+         node = node->next, otherNode = otherNode->next) {
+        if (compare(node->pair.first, otherNode->pair.first) || compare(otherNode->pair.first, node->pair.first)
+            || node->pair.second != otherNode->pair.second)
             return false;
         }
     return true;
@@ -160,9 +598,12 @@ public:
     return !(*this == other);
   }
 
+  //mutable access of any kind unshares the tree, iterating a snapshot does not
+  //when it is done through const_iterators
   iterator begin()
   {
-    return iterator(*this, theLowest() );
+    unshare();
+    return iterator(*this, leftmost );
   }
 
   iterator end()
@@ -172,7 +613,7 @@ public:
 
   const_iterator cbegin() const
   {
-    return ConstIterator(*this, theLowest() );
+    return ConstIterator(*this, leftmost );
   }
 
   const_iterator cend() const
@@ -190,7 +631,7 @@ public:
   }
   ~TreeMap()
   {
-    deleteTree(root);
+    releaseTree();
   }
 private:
 void insert(value_type newPair)
@@ -200,154 +641,815 @@ void insert(value_type newPair)
 }
 Node* insert(key_type key)
 {
-    Node* newNode= new Node(std::make_pair(key, ValueType()));
-    newNode->left=nullptr;
-    newNode->right=nullptr;
-    ++size;
+    return insertNode(new Node(std::make_pair(key, ValueType())));
+}
+//places a node with a key that is not in the tree yet
+Node* insertNode(Node* newNode)
+{
     if(root==nullptr){
+        ++size;
         root=newNode;
         root->parent=nullptr;
+        leftmost=rightmost=root;
         return root;
     }
+    //keys appended in increasing order do not descend the tree
+    if(compare(rightmost->pair.first, newNode->pair.first))
+        return attachRight(newNode, rightmost);
     Node* temp=root;
     Node* parent;
     while(true){
         parent=temp;
-        if(temp->pair.first > newNode->pair.first){
+        if(compare(newNode->pair.first, temp->pair.first)){
             temp=temp->left;
-            if(temp==nullptr){
-                newNode->parent=parent;
-                parent->left=newNode;
-                break;
-            }
+            if(temp==nullptr)
+                return attachLeft(newNode, parent);
         }
         else{
             temp=temp->right;
-            if(temp==nullptr){
-                newNode->parent=parent;
-                parent->right=newNode;
-                break;
-            }
+            if(temp==nullptr)
+                return attachRight(newNode, parent);
         }
     }
-    return newNode;
   }
-  void deleteTree(Node* node)
+  Node* attachLeft(Node* node, Node* parent)
+  {
+      node->parent=parent;
+      parent->left=node;
+      linkBefore(node, parent);
+      if(parent==leftmost)
+          leftmost=node;
+      return settle(node);
+  }
+  Node* attachRight(Node* node, Node* parent)
+  {
+      node->parent=parent;
+      parent->right=node;
+      linkAfter(node, parent);
+      if(parent==rightmost)
+          rightmost=node;
+      return settle(node);
+  }
+  //counts a new leaf in the weights of its ancestors and rotates it up to its place in the heap
+  Node* settle(Node* node)
+  {
+      ++size;
+      for (Node* ancestor=node->parent; ancestor!=nullptr; ancestor=ancestor->parent)
+          ++ancestor->weight;
+      while(node->parent!=nullptr && node->priority>node->parent->priority)
+          rotateUp(node);
+      return node;
+  }
+  Node* findOrInsert(value_type&& item)
+  {
+      Node* node=findNode(item.first);
+      return node!=nullptr ? node : insertNode(new Node(std::move(item)));
+  }
+  void deleteTree()
+  {
+    releaseTree();
+    root=leftmost=rightmost=finger=nullptr;
+    size=0;
+  }
+  //the counter of the tree for a new snapshot, allocated on the first one; snapshots of
+  //one map may be taken concurrently, as they are const
+  std::atomic<size_type>* share() const
+  {
+    std::atomic<size_type>* counter=owners.load(std::memory_order_acquire);
+    if(counter==nullptr){
+        std::atomic<size_type>* created=new std::atomic<size_type>(1);
+        if(owners.compare_exchange_strong(counter, created, std::memory_order_acq_rel))
+            counter=created;
+        else
+            delete created;
+    }
+    counter->fetch_add(1, std::memory_order_relaxed);
+    return counter;
+  }
+  //drops the map's share of the tree, leaving it the only owner of nothing; the last map
+  //holding the tree frees the counter and the nodes along the in-order list (iterative,
+  //O(n), O(1) extra space)
+  void releaseTree()
+  {
+    std::atomic<size_type>* counter=owners.exchange(nullptr, std::memory_order_relaxed);
+    if(counter!=nullptr){
+        if(counter->fetch_sub(1, std::memory_order_acq_rel)!=1)
+            return;
+        delete counter;
+    }
+    Node* node=leftmost;
+    while(node!=nullptr){
+        Node* next=node->next;
+        delete node;
+        node=next;
+    }
+  }
+  //before the first modification of a shared tree the map takes a private clone of it;
+  //tracked and alsoTracked, nodes of the shared tree, are redirected to their clones
+  void unshare(Node*& tracked, Node*& alsoTracked)
+  {
+    std::atomic<size_type>* counter=owners.load(std::memory_order_acquire);
+    if(counter==nullptr)
+        return;
+    if(counter->load(std::memory_order_acquire)==1){
+        //the snapshots are gone, the counter is not needed until the next one
+        owners.store(nullptr, std::memory_order_relaxed);
+        delete counter;
+        return;
+    }
+    Node* last=nullptr;
+    Node* clone=cloneSubtree(root, nullptr, last, tracked, alsoTracked);
+    releaseTree();
+    root=leftmost=clone;
+    while(leftmost!=nullptr && leftmost->left!=nullptr)
+        leftmost=leftmost->left;
+    rightmost=last;
+    finger=nullptr;
+  }
+  void unshare()
+  {
+    Node* none=nullptr;
+    unshare(none, none);
+  }
+  //copies a subtree keeping its shape and priorities, appends the copies to the list after last;
+  //if copying an item throws, the copies made so far are freed
+  static Node* cloneSubtree(const Node* node, Node* parent, Node*& last, Node*& tracked, Node*& alsoTracked)
+  {
+    if(node==nullptr)
+        return nullptr;
+    Node* copy=new Node(node->pair);
+    copy->priority=node->priority;
+    copy->weight=node->weight;
+    copy->parent=parent;
+    try{
+        copy->left=cloneSubtree(node->left, copy, last, tracked, alsoTracked);
+        copy->prev=last;
+        if(last!=nullptr)
+            last->next=copy;
+        last=copy;
+        if(node==tracked)
+            tracked=copy;
+        if(node==alsoTracked)
+            alsoTracked=copy;
+        copy->right=cloneSubtree(node->right, copy, last, tracked, alsoTracked);
+    }
+    catch(...){
+        deleteClone(copy);
+        throw;
+    }
+    return copy;
+  }
+  static void deleteClone(Node* node)
   {
     if(node==nullptr)
         return;
-    deleteTree(node->left);
-    deleteTree(node->right);
-   // delete nodeToStart;
-    //--size;
-
-    if (node->left != nullptr) {
-        --size;
-        delete node->left;
-        node->left = nullptr;
+    deleteClone(node->left);
+    deleteClone(node->right);
+    delete node;
+  }
+  using Item = std::pair<key_type, mapped_type>;
+  //below this many elements fork-join helpers stay on the calling thread
+  static const size_type PARALLEL_GRAIN=1<<14;
+
+  static unsigned defaultThreads()
+  {
+    const unsigned threads=std::thread::hardware_concurrency();
+    return threads==0 ? 1 : threads;
+  }
+  //number of fork-join levels needed to keep `threads` threads busy
+  static unsigned forkDepth(unsigned threads)
+  {
+    unsigned depth=0;
+    while((1u<<depth)<threads)
+        ++depth;
+    return depth;
+  }
+  //runs f on a new thread (or inline, if fork is false or no thread can be started) and g inline;
+  //both always run to the end, then an exception of either is passed on, f's first
+  template <typename F, typename G>
+  static void forkJoin(bool fork, F f, G g)
+  {
+    std::exception_ptr fError, gError;
+    auto guardedF=[&]{
+        try{
+            f();
+        }
+        catch(...){
+            fError=std::current_exception();
+        }
+    };
+    std::thread worker;
+    if(fork){
+        try{
+            worker=std::thread(guardedF);
+        }
+        catch(const std::system_error&){
+            fork=false;
+        }
     }
-    if (node->right != nullptr) {
-        --size;
-        delete node->right;
-        node->right = nullptr;
+    if(!fork)
+        guardedF();
+    try{
+        g();
     }
-    if (node == root) {
-        delete root;
-        root = nullptr;
-        --size;
+    catch(...){
+        gError=std::current_exception();
     }
+    if(worker.joinable())
+        worker.join();
+    if(fError!=nullptr)
+        std::rethrow_exception(fError);
+    if(gError!=nullptr)
+        std::rethrow_exception(gError);
   }
-  Node* findNode(const key_type& key) const
+  //stable, so that equal keys stay in input order
+  void parallelSort(Item* begin, Item* end, unsigned depth) const
+  {
+    const auto itemLess=[this](const Item& a, const Item& b){ return compare(a.first, b.first); };
+    if(depth==0 || static_cast<size_type>(end-begin)<PARALLEL_GRAIN){
+        std::stable_sort(begin, end, itemLess);
+        return;
+    }
+    Item* middle=begin+(end-begin)/2;
+    forkJoin(true, [=]{ parallelSort(begin, middle, depth-1); },
+                   [=]{ parallelSort(middle, end, depth-1); });
+    std::inplace_merge(begin, middle, end, itemLess);
+  }
+  //keeps the last item of every run of equal keys
+  template <typename It>
+  It uniqueKeepLast(It first, It last) const
+  {
+    It result=first;
+    for (It it=first; it!=last; ++it) {
+        It next=it;
+        ++next;
+        if(next!=last && !compare(it->first, next->first))
+            continue;
+        if(result!=it)
+            *result=std::move(*it);
+        ++result;
+    }
+    return result;
+  }
+  //fills the empty slots with nodes of their items, in parallel chunks;
+  //when an allocation fails the new nodes are freed and the tree stays untouched
+  void allocateNodes(std::vector<Node*>& nodes, std::vector<std::pair<size_type, Item*>>& newItems, unsigned threads)
+  {
+    const size_type chunks=std::max<size_type>(1, std::min<size_type>(threads, newItems.size()/PARALLEL_GRAIN));
+    std::vector<std::exception_ptr> errors(chunks);
+    std::vector<std::thread> workers;
+    auto allocateChunk=[&](size_type chunk){
+        try{
+            for (size_type i=newItems.size()*chunk/chunks; i<newItems.size()*(chunk+1)/chunks; ++i)
+                nodes[newItems[i].first]=new Node(value_type(std::move(newItems[i].second->first),
+                                                             std::move(newItems[i].second->second)));
+        }
+        catch(...){
+            errors[chunk]=std::current_exception();
+        }
+    };
+    for (size_type chunk=1; chunk<chunks; ++chunk) {
+        try{
+            workers.emplace_back(allocateChunk, chunk);
+        }
+        catch(const std::system_error&){
+            allocateChunk(chunk);
+        }
+    }
+    allocateChunk(0);
+    for (auto&& worker : workers)
+        worker.join();
+    for (auto&& error : errors) {
+        if(error!=nullptr){
+            for (auto&& item : newItems)
+                delete nodes[item.first];
+            std::rethrow_exception(error);
+        }
+    }
+  }
+  //links nodes[0..n) into a balanced subtree and the in-order list, subtrees built in parallel
+  static void buildBalanced(Node** all, Node** nodes, size_type n, size_type total, Node* parent, unsigned depth)
+  {
+      const size_type middle=n/2;
+      Node* node=nodes[middle];
+      const size_type index=nodes+middle-all;
+      node->parent=parent;
+      node->prev= index>0 ? all[index-1] : nullptr;
+      node->next= index+1<total ? all[index+1] : nullptr;
+      node->left= middle>0 ? nodes[middle/2] : nullptr;
+      node->right= n-middle-1>0 ? nodes[middle+1+(n-middle-1)/2] : nullptr;
+      const unsigned childDepth= depth==0 ? 0 : depth-1;
+      forkJoin(depth>0 && n>=PARALLEL_GRAIN,
+               [=]{ if(middle>0) buildBalanced(all, nodes, middle, total, node, childDepth); },
+               [=]{ if(n-middle-1>0) buildBalanced(all, nodes+middle+1, n-middle-1, total, node, childDepth); });
+      node->weight=n;
+      restoreHeapOrder(node);
+  }
+  //empty map only: appends nodes to the in-order list as long as keys ascend
+  //and builds a balanced tree of them, returns the first out-of-order position
+  template <typename InputIt>
+  InputIt assignSorted(InputIt first, InputIt last)
+  {
+    for (; first!=last; ++first) {
+        if(rightmost!=nullptr && !compare(rightmost->pair.first, first->first)){
+            if(compare(first->first, rightmost->pair.first))
+                break;
+            rightmost->pair.second=first->second;
+            continue;
+        }
+        Node* newNode=new Node(value_type(first->first, first->second));
+        if(rightmost==nullptr)
+            leftmost=newNode;
+        else
+            linkAfter(newNode, rightmost);
+        rightmost=newNode;
+        ++size;
+    }
+    Node* head=leftmost;
+    root=buildBalanced(head, size, nullptr);
+    return first;
+  }
+  //makes a balanced subtree of n list nodes starting at head, moves head past them
+  static Node* buildBalanced(Node*& head, size_type n, Node* parent)
+  {
+      if(n==0)
+          return nullptr;
+      Node* left=buildBalanced(head, n/2, nullptr);
+      Node* node=head;
+      head=head->next;
+      node->parent=parent;
+      node->left=left;
+      if(left!=nullptr)
+          left->parent=node;
+      node->right=buildBalanced(head, n-n/2-1, node);
+      node->weight=n;
+      restoreHeapOrder(node);
+      return node;
+  }
+  //a node of a freshly built tree takes the highest priority of its subtree
+  static void restoreHeapOrder(Node* node)
+  {
+      if(node->left!=nullptr)
+          node->priority=std::max(node->priority, node->left->priority);
+      if(node->right!=nullptr)
+          node->priority=std::max(node->priority, node->right->priority);
+  }
+  template <typename K>
+  int threeWay(const key_type& a, const K& b) const
+  {
+      return threeWayCompare(compare, a, b);
+  }
+  using BuiltInOrder=std::integral_constant<bool, std::is_arithmetic<KeyType>::value
+                                                  && std::is_same<Compare, std::less<KeyType>>::value>;
+  template <typename K>
+  Node* findNode(const K& key) const
+  {
+      if(fingerSearch)
+          return fingerFindNode(key);
+      return descend(key, BuiltInOrder());
+  }
+  //one three-way comparison per level, e.g. a single pass over the characters of strings
+  template <typename K>
+  Node* descend(const K& key, std::false_type) const
   {
       Node* node=root;
       while (node!=nullptr)
       {
-          if(node->pair.first==key)
+          const int order=threeWay(node->pair.first, key);
+          if(order==0)
             return node;
-          if(node->pair.first>key)
+          if(order>0)
             node=node->left;
           else
             node=node->right;
       }
       return nullptr;
   }
-  Node* theLowest() const//!!pytanie o brak consta i wywo章nie iteratora
+  //built-in keys compare in one instruction and the child is picked by a conditional move;
+  //this beats a lower bound descent without the early exit and the sign of a three-way result
+  template <typename K>
+  Node* descend(const K& key, std::true_type) const
   {
-    if(isEmpty())
-        return nullptr;
-    Node* temp=root;
-    while(temp->left!=nullptr)
-        temp=temp->left;
-    return temp;
+      Node* node=root;
+      while(node!=nullptr && !(node->pair.first==key))
+          node= compare(key, node->pair.first) ? node->left : node->right;
+      return node;
   }
-  void deleteRoot()
+  template <typename K>
+  Node* fingerFindNode(const K& key) const
   {
-      --size;
-      Node*oldRoot=root;
-      if(root->right==nullptr){
-          root=root->left;
-          delete oldRoot;
-          return;
+      ++fingerCounters.lookups;
+      Node* node= finger==nullptr || threeWay(finger->pair.first, key)==0 ? finger : climbFrom(finger, key);
+      if(node==nullptr)
+          node=root;
+      else if(node!=root)
+          ++fingerCounters.hits;
+      while(node!=nullptr){
+          ++fingerCounters.steps;
+          finger=node;
+          const int order=threeWay(node->pair.first, key);
+          if(order==0)
+              break;
+          node= order>0 ? node->left : node->right;
       }
-      root=root->right;
-      if(oldRoot->left!=nullptr){
-        Node*temp=root;
-        while(temp->left!=nullptr)
-            temp=temp->left;
-        temp->left=oldRoot->left;
+      return node;
+  }
+  //returns the lowest node above the finger whose subtree can hold key; for key above the
+  //finger the upper fence of a subtree is the nearest ancestor reached from a left child
+  //(the lower fence is below the finger already), symmetrically for key below it
+  template <typename K>
+  Node* climbFrom(Node* node, const K& key) const
+  {
+      const bool greater=compare(node->pair.first, key);
+      Node* lowest=node;
+      while(node->parent!=nullptr){
+          Node* parent=node->parent;
+          ++fingerCounters.steps;
+          if(greater ? parent->left==node : parent->right==node){
+              const int order=threeWay(parent->pair.first, key);
+              if(order==0)
+                  return parent;
+              if(greater ? order>0 : order<0)
+                  return lowest;
+              lowest=parent;
+          }
+          node=parent;
       }
-      delete oldRoot;
+      return node;
+  }
+  //a new left child is the in-order predecessor of its parent
+  static void linkBefore(Node* node, Node* successor)
+  {
+      node->next=successor;
+      node->prev=successor->prev;
+      if(successor->prev!=nullptr)
+          successor->prev->next=node;
+      successor->prev=node;
+  }
+  //a new right child is the in-order successor of its parent
+  static void linkAfter(Node* node, Node* predecessor)
+  {
+      node->prev=predecessor;
+      node->next=predecessor->next;
+      if(predecessor->next!=nullptr)
+          predecessor->next->prev=node;
+      predecessor->next=node;
+  }
+  //puts subtree "with" in the place of "node" in node's parent
+  void replaceChild(Node* node, Node* with)
+  {
+      if(node->parent==nullptr)
+          root=with;
+      else if(node->parent->left==node)
+          node->parent->left=with;
+      else
+          node->parent->right=with;
+      if(with!=nullptr)
+          with->parent=node->parent;
   }
-  void deleteRightChild(Node* toRemove)
+  void removeNode(Node* toRemove)
   {
+      if(toRemove==leftmost)
+          leftmost=toRemove->next;
+      if(toRemove==rightmost)
+          rightmost=toRemove->prev;
+      if(toRemove==finger)
+          finger=nullptr;
+      if(toRemove->prev!=nullptr)
+          toRemove->prev->next=toRemove->next;
+      if(toRemove->next!=nullptr)
+          toRemove->next->prev=toRemove->prev;
+      replaceChild(toRemove, joinNodes(toRemove->left, toRemove->right));
+      for (Node* node=toRemove->parent; node!=nullptr; node=node->parent)
+          --node->weight;
       --size;
-      if(toRemove->left==nullptr){
-          toRemove->parent->right=toRemove->right;
-          delete toRemove;
+      delete toRemove;
+  }
+  static size_type weightOf(const Node* node)
+  {
+      return node==nullptr ? 0 : node->weight;
+  }
+  static void updateWeight(Node* node)
+  {
+      node->weight=1+weightOf(node->left)+weightOf(node->right);
+  }
+  static void setLeft(Node* node, Node* child)
+  {
+      node->left=child;
+      if(child!=nullptr)
+          child->parent=node;
+  }
+  static void setRight(Node* node, Node* child)
+  {
+      node->right=child;
+      if(child!=nullptr)
+          child->parent=node;
+  }
+  //moves node one level up, its parent becomes its child
+  void rotateUp(Node* node)
+  {
+      Node* parent=node->parent;
+      replaceChild(parent, node);
+      if(parent->left==node){
+          setLeft(parent, node->right);
+          setRight(node, parent);
+      }
+      else{
+          setRight(parent, node->left);
+          setLeft(node, parent);
+      }
+      updateWeight(parent);
+      updateWeight(node);
+  }
+  //joins two treaps, all keys of left being smaller than those of right
+  static Node* joinNodes(Node* left, Node* right)
+  {
+      if(left==nullptr)
+          return right;
+      if(right==nullptr)
+          return left;
+      if(left->priority>right->priority){
+          setRight(left, joinNodes(left->right, right));
+          updateWeight(left);
+          return left;
+      }
+      setLeft(right, joinNodes(left, right->left));
+      updateWeight(right);
+      return right;
+  }
+  //splits a treap into nodes with keys smaller and greater than key, a node with key itself is cut out;
+  //pred and succ end up at the last nodes where the search went right and left
+  void splitNodes(Node* node, const key_type& key, Node*& left, Node*& found, Node*& right,
+                  Node*& pred, Node*& succ) const
+  {
+      if(node==nullptr){
+          left=right=nullptr;
           return;
       }
-      Node*temp=toRemove->left;
-      toRemove->parent->right=temp;
-      if(toRemove->right!=nullptr){
-        while(temp->right!=nullptr)
-            temp=temp->right;
-        temp->right=toRemove->right;
+      const int order=threeWay(node->pair.first, key);
+      if(order==0){
+          found=node;
+          left=node->left;
+          right=node->right;
+          node->left=node->right=nullptr;
+          node->weight=1;
+          return;
+      }
+      if(order<0){
+          pred=node;
+          Node* rest;
+          splitNodes(node->right, key, rest, found, right, pred, succ);
+          setRight(node, rest);
+          updateWeight(node);
+          left=node;
+      }
+      else{
+          succ=node;
+          Node* rest;
+          splitNodes(node->left, key, left, found, rest, pred, succ);
+          setLeft(node, rest);
+          updateWeight(node);
+          right=node;
       }
-      delete toRemove;
   }
-  void deleteLeftChild(Node* toRemove)
+  //a detached treap together with its own part of the in-order list
+  struct Subtree
   {
-     --size;
-      if(toRemove->right==nullptr){
-        toRemove->parent->left=toRemove->left;
-        delete toRemove;
-        return;
+      Node* root;
+      Node* first;
+      Node* last;
+  };
+  Subtree takeTree()
+  {
+      unshare();
+      Subtree tree={ root, leftmost, rightmost };
+      root=leftmost=rightmost=finger=nullptr;
+      size=0;
+      return tree;
+  }
+  void setTree(const Subtree& tree)
+  {
+      root=tree.root;
+      leftmost=tree.first;
+      rightmost=tree.last;
+      size=weightOf(root);
+      if(root!=nullptr)
+          root->parent=nullptr;
+  }
+  static void deleteSubtree(const Subtree& tree)
+  {
+      Node* node=tree.first;
+      while(node!=nullptr){
+          Node* next=node->next;
+          delete node;
+          node=next;
       }
-      toRemove->parent->left=toRemove->right;
-      if(toRemove->left!=nullptr){
-        Node*temp=toRemove->right;
-        while(temp->left!=nullptr)
-            temp=temp->left;
-        temp->left=toRemove->left;
+  }
+  void splitTree(const Subtree tree, const key_type& key, Subtree& left, Node*& found, Subtree& right) const
+  {
+      Node *leftRoot, *rightRoot, *pred=nullptr, *succ=nullptr;
+      found=nullptr;
+      splitNodes(tree.root, key, leftRoot, found, rightRoot, pred, succ);
+      if(found!=nullptr){
+          pred=found->prev;
+          succ=found->next;
+          found->prev=found->next=nullptr;
       }
-      delete toRemove;
-      return;
+      if(pred!=nullptr)
+          pred->next=nullptr;
+      if(succ!=nullptr)
+          succ->prev=nullptr;
+      if(leftRoot!=nullptr)
+          leftRoot->parent=nullptr;
+      if(rightRoot!=nullptr)
+          rightRoot->parent=nullptr;
+      left={ leftRoot, leftRoot!=nullptr ? tree.first : nullptr, pred };
+      right={ rightRoot, succ, rightRoot!=nullptr ? tree.last : nullptr };
   }
-  Node* getLast() const
+  //splits into keys smaller than key and the rest, the results may overwrite tree
+  void splitBefore(const Subtree tree, const key_type& key, Subtree& smaller, Subtree& rest) const
   {
-      Node* node=root;
-      while(node->right!=nullptr)
-        node=node->right;
+      Node* found;
+      splitTree(tree, key, smaller, found, rest);
+      if(found!=nullptr)
+          rest=joinTrees({ found, found, found }, rest);
+  }
+  static Subtree joinTrees(const Subtree& left, const Subtree& right)
+  {
+      if(left.root==nullptr)
+          return right;
+      if(right.root==nullptr)
+          return left;
+      left.last->next=right.first;
+      right.first->prev=left.last;
+      Node* joined=joinNodes(left.root, right.root);
+      joined->parent=nullptr;
+      return { joined, left.first, right.last };
+  }
+  //cuts the root out of a treap, leaving its two subtrees
+  static Node* detachRoot(const Subtree& tree, Subtree& left, Subtree& right)
+  {
+      Node* node=tree.root;
+      left={ node->left, node->left!=nullptr ? tree.first : nullptr, node->left!=nullptr ? node->prev : nullptr };
+      right={ node->right, node->right!=nullptr ? node->next : nullptr, node->right!=nullptr ? tree.last : nullptr };
+      if(node->prev!=nullptr)
+          node->prev->next=nullptr;
+      if(node->next!=nullptr)
+          node->next->prev=nullptr;
+      if(node->left!=nullptr)
+          node->left->parent=nullptr;
+      if(node->right!=nullptr)
+          node->right->parent=nullptr;
+      node->prev=node->next=node->left=node->right=nullptr;
+      node->weight=1;
       return node;
   }
+  //node must have a priority not lower than the roots of both subtrees
+  static Subtree attach(const Subtree& left, Node* node, const Subtree& right)
+  {
+      setLeft(node, left.root);
+      setRight(node, right.root);
+      updateWeight(node);
+      node->parent=nullptr;
+      if(left.root!=nullptr){
+          left.last->next=node;
+          node->prev=left.last;
+      }
+      if(right.root!=nullptr){
+          right.first->prev=node;
+          node->next=right.first;
+      }
+      return { node, left.root!=nullptr ? left.first : node, right.root!=nullptr ? right.last : node };
+  }
+  static bool forkSetOperation(const Subtree& a, const Subtree& b, unsigned depth)
+  {
+      return depth>0 && weightOf(a.root)+weightOf(b.root)>=PARALLEL_GRAIN;
+  }
+  //a set operation that throws (only the comparator can) has freed all the nodes of its
+  //input: a split that throws leaves the in-order list whole, and a half that throws has
+  //freed its own part, so the rest is freed here
+  template <typename F, typename G>
+  static void forkJoinHalves(bool fork, F f, G g, Subtree& left, Subtree& right, Node* pivot, Node* duplicate)
+  {
+      try{
+          forkJoin(fork, f, g);
+      }
+      catch(...){
+          deleteSubtree(left);
+          deleteSubtree(right);
+          delete pivot;
+          delete duplicate;
+          throw;
+      }
+  }
+  template <typename Split>
+  static void splitOrFree(Split split, const Subtree& tree, const Subtree& left, const Subtree& right, Node* pivot)
+  {
+      try{
+          split();
+      }
+      catch(...){
+          deleteSubtree(tree);
+          deleteSubtree(left);
+          deleteSubtree(right);
+          delete pivot;
+          throw;
+      }
+  }
+  //the root with the higher priority is the pivot, so it stays the root of the result;
+  //secondWins tells whether values of b override those of a
+  Subtree unionOf(Subtree a, Subtree b, bool secondWins, unsigned depth) const
+  {
+      if(a.root==nullptr)
+          return b;
+      if(b.root==nullptr)
+          return a;
+      if(a.root->priority<b.root->priority){
+          std::swap(a, b);
+          secondWins=!secondWins;
+      }
+      const bool fork=forkSetOperation(a, b, depth);
+      Subtree aLeft, aRight, bLeft, bRight, left{}, right{};
+      Node* duplicate;
+      Node* pivot=detachRoot(a, aLeft, aRight);
+      splitOrFree([&]{ splitTree(b, pivot->pair.first, bLeft, duplicate, bRight); }, b, aLeft, aRight, pivot);
+      if(duplicate!=nullptr){
+          if(secondWins)
+              pivot->pair.second=std::move(duplicate->pair.second);
+          delete duplicate;
+      }
+      const unsigned childDepth= depth==0 ? 0 : depth-1;
+      forkJoinHalves(fork, [&]{ left=unionOf(aLeft, bLeft, secondWins, childDepth); },
+                           [&]{ right=unionOf(aRight, bRight, secondWins, childDepth); }, left, right, pivot,
+                     nullptr);
+      return attach(left, pivot, right);
+  }
+  Subtree intersectionOf(Subtree a, Subtree b, bool secondWins, unsigned depth) const
+  {
+      if(a.root==nullptr || b.root==nullptr){
+          deleteSubtree(a);
+          deleteSubtree(b);
+          return { nullptr, nullptr, nullptr };
+      }
+      if(a.root->priority<b.root->priority){
+          std::swap(a, b);
+          secondWins=!secondWins;
+      }
+      const bool fork=forkSetOperation(a, b, depth);
+      Subtree aLeft, aRight, bLeft, bRight, left{}, right{};
+      Node* duplicate;
+      Node* pivot=detachRoot(a, aLeft, aRight);
+      splitOrFree([&]{ splitTree(b, pivot->pair.first, bLeft, duplicate, bRight); }, b, aLeft, aRight, pivot);
+      const unsigned childDepth= depth==0 ? 0 : depth-1;
+      forkJoinHalves(fork, [&]{ left=intersectionOf(aLeft, bLeft, secondWins, childDepth); },
+                           [&]{ right=intersectionOf(aRight, bRight, secondWins, childDepth); }, left, right,
+                     pivot, duplicate);
+      if(duplicate==nullptr){
+          delete pivot;
+          return joinTrees(left, right);
+      }
+      if(secondWins)
+          pivot->pair.second=std::move(duplicate->pair.second);
+      delete duplicate;
+      return attach(left, pivot, right);
+  }
+  //items of a whose keys are not in b
+  Subtree differenceOf(Subtree a, Subtree b, unsigned depth) const
+  {
+      if(a.root==nullptr || b.root==nullptr){
+          deleteSubtree(b);
+          return a;
+      }
+      const bool fork=forkSetOperation(a, b, depth);
+      Subtree aLeft, aRight, bLeft, bRight, left{}, right{};
+      Node* found;
+      Node* pivot=detachRoot(b, bLeft, bRight);
+      splitOrFree([&]{ splitTree(a, pivot->pair.first, aLeft, found, aRight); }, a, bLeft, bRight, pivot);
+      delete pivot;
+      delete found;
+      const unsigned childDepth= depth==0 ? 0 : depth-1;
+      forkJoinHalves(fork, [&]{ left=differenceOf(aLeft, bLeft, childDepth); },
+                           [&]{ right=differenceOf(aRight, bRight, childDepth); }, left, right, nullptr,
+                     nullptr);
+      return joinTrees(left, right);
+  }
+  static std::uint64_t randomPriority()
+  {
+      return threadRandom();
+  }
+  Node* getLast() const
+  {
+      return rightmost;
+  }
 
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare>
+class TreeMap<KeyType, ValueType, Compare>::ConstIterator
 {
-private:
-    const TreeMap& tree;
+    friend class TreeMap;
+protected:
+    const TreeMap* tree;
     Node* current;
 public:
   using reference = typename TreeMap::const_reference;
@@ -355,26 +1457,19 @@ public:
   using value_type = typename TreeMap::value_type;
   using pointer = const typename TreeMap::value_type*;
 
-  explicit ConstIterator(const TreeMap& pTree, Node* node): tree(pTree), current(node)
+  explicit ConstIterator(const TreeMap& pTree, Node* node): tree(&pTree), current(node)
         {};
 
   ConstIterator( const ConstIterator& other): tree(other.tree), current(other.current)
         {};
 
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
   ConstIterator& operator++()
   {
     if(current==nullptr)
         throw std::out_of_range("can not increment the end");
-    if(current->right!=nullptr){
-        current=current->right;
-        while(current->left!=nullptr)
-            current=current->left;
-        return *this;
-    }
-    while(current->parent!=nullptr && current->parent->left!=current){
-        current=current->parent;
-    }
-    current=current->parent;
+    current=current->next;
     return *this;
   }
 
@@ -387,34 +1482,22 @@ public:
 
   ConstIterator& operator--()
   {
-    if(tree.isEmpty())
+    if(tree->isEmpty())
         throw std::out_of_range("can not decrement iterator of empty collection");
     if(current==nullptr){
-        current=tree.getLast();
-        return *this;
-    }
-    if(current->left!=nullptr){
-        current=current->left;
-        while(current->right!=nullptr)
-            current=current->right;
+        current=tree->getLast();
         return *this;
     }
-    do{
-        if(current->parent==nullptr)
-            throw std::out_of_range("can not decrement begin");//!!czy sprawdza to jakis test-> nie dopisz
-        if(current->parent->right==current)
-            break;
-        current=current->parent;
-    }
-    while(true);
-    current=current->parent;
+    if(current->prev==nullptr)
+        throw std::out_of_range("can not decrement begin");
+    current=current->prev;
     return *this;
   }
 
   ConstIterator operator--(int)
   {
     ConstIterator temp(*this);
-    operator++();
+    operator--();
     return temp;
   }
 
@@ -423,14 +1506,14 @@ public:
     //if(tree.isEmpty())
        // throw std::out_of_range("can not refer iterator of empty collection"); takie cos pzechodzi testy
     if(current==nullptr)
-        std::out_of_range("can not refer iterator of end");
+        throw std::out_of_range("can not refer iterator of end");
     return current->pair;
   }
 
   pointer operator->() const
   {
     if(current==nullptr)
-        std::out_of_range("can not derefer iterator of end");
+        throw std::out_of_range("can not derefer iterator of end");
     return &this->operator*();
   }
 
@@ -449,36 +1532,40 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::Node
+template <typename KeyType, typename ValueType, typename Compare>
+class TreeMap<KeyType, ValueType, Compare>::Node
 {
     friend class TreeMap;
   private:
       Node* parent;
       Node* left;
       Node* right;
+      Node* prev;//in-order predecessor, nullptr for the first node
+      Node* next;//in-order successor, nullptr for the last node
+      size_type weight;//number of nodes in the subtree
+      std::uint64_t priority;
       value_type pair;
   public:
-    Node(): pair(std::make_pair(KeyType(), ValueType()) ),  parent(nullptr), left(nullptr), right(nullptr)
+    Node(): parent(nullptr), left(nullptr), right(nullptr), prev(nullptr), next(nullptr), weight(1),
+            priority(TreeMap::randomPriority()), pair(std::make_pair(KeyType(), ValueType()) )
             {};
-    Node(value_type pPair): pair(pPair), parent(nullptr), left(nullptr), right(nullptr)
+    Node(value_type pPair): parent(nullptr), left(nullptr), right(nullptr), prev(nullptr), next(nullptr), weight(1),
+            priority(TreeMap::randomPriority()), pair(pPair)
             {};
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::Iterator : public TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare>
+class TreeMap<KeyType, ValueType, Compare>::Iterator : public TreeMap<KeyType, ValueType, Compare>::ConstIterator
 {
 public:
   using reference = typename TreeMap::reference;
   using pointer = typename TreeMap::value_type*;
 
-  explicit Iterator( const TreeMap& tree, Node*node): ConstIterator(tree, node)
+  //only a non-const map hands out iterators, after unsharing its tree; a const_iterator
+  //becomes one through TreeMap::toIterator
+  explicit Iterator( TreeMap& tree, Node*node): ConstIterator(tree, node)
     {};
 
-  Iterator(const ConstIterator& other)
-    : ConstIterator(other)
-  {}
-
   Iterator& operator++()
   {
     ConstIterator::operator++();
@@ -1,27 +1,716 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "FilteredMap.h"
+#include "FlatMap.h"
+#include "FrozenMap.h"
+#include "HashMap.h"
+#include "LsmMap.h"
+#include "PersistentTreeMap.h"
+#include "RadixTreeMap.h"
+#include "SkipListMap.h"
+#include "SmallMap.h"
 #include "TreeMap.h"
 
 namespace
 {
 
-template <typename K, typename V>
-using Map = aisdi::Map<K, V>;
+using Key = std::uint64_t;
+using Value = std::uint64_t;
+using Keys = std::vector<Key>;
 
-void perfomTest()
+// Result sink, so that the measured loops are not optimised away.
+volatile Value sink;
+
+struct Benchmark
+{
+  std::string name;
+  // Returns the mean time of a single operation in nanoseconds.
+  std::function<double(const Keys&, const Keys&)> run;
+  // Whether perfcheck may fail on it; results that depend on the cores of the
+  // machine more than on the code are only reported.
+  bool gated = true;
+};
+
+template <typename F>
+double nanosecondsPerOperation(std::size_t operations, F body)
+{
+  const auto start = std::chrono::steady_clock::now();
+  body();
+  const auto stop = std::chrono::steady_clock::now();
+  const std::chrono::duration<double, std::nano> elapsed = stop - start;
+  return elapsed.count() / (operations == 0 ? 1 : operations);
+}
+
+template <typename Map>
+Map makeMap(const Keys& keys)
+{
+  Map map;
+  for (const auto key : keys)
+    map[key] = key;
+  return map;
+}
+
+template <typename Map>
+double insert(const Keys& keys, const Keys&)
+{
+  Map map;
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    for (const auto key : keys)
+      map[key] = key;
+  });
+}
+
+template <typename Map>
+double append(const Keys& keys, const Keys&)
+{
+  Keys sorted(keys);
+  std::sort(sorted.begin(), sorted.end());
+  Map map;
+  return nanosecondsPerOperation(sorted.size(), [&]() {
+    for (const auto key : sorted)
+      map.insert(map.end(), key, key);
+  });
+}
+
+template <typename Map>
+double find(const Keys& keys, const Keys&)
+{
+  const Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    Value sum = 0;
+    for (const auto key : keys)
+      sum += map.find(key)->second;
+    sink = sum;
+  });
+}
+
+// Looks the keys up in increasing order, so that each lookup is near the previous one.
+template <typename Map, bool FingerSearch>
+double findNear(const Keys& keys, const Keys&)
+{
+  Map map = makeMap<Map>(keys);
+  map.setFingerSearch(FingerSearch);
+  Keys sorted(keys);
+  std::sort(sorted.begin(), sorted.end());
+  return nanosecondsPerOperation(sorted.size(), [&]() {
+    Value sum = 0;
+    for (const auto key : sorted)
+      sum += map.find(key)->second;
+    sink = sum;
+  });
+}
+
+template <typename Map>
+double findMissing(const Keys& keys, const Keys& missing)
+{
+  const Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(missing.size(), [&]() {
+    Value hits = 0;
+    for (const auto key : missing)
+      hits += map.find(key) != map.end();
+    sink = hits;
+  });
+}
+
+template <typename Map>
+double iterate(const Keys& keys, const Keys&)
+{
+  const Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    Value sum = 0;
+    for (const auto& item : map)
+      sum += item.second;
+    sink = sum;
+  });
+}
+
+template <typename Map>
+double remove(const Keys& keys, const Keys&)
+{
+  Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    for (const auto key : keys)
+      map.remove(key);
+  });
+}
+
+// Removes every second key in one pass.
+template <typename Map>
+double eraseIf(const Keys& keys, const Keys&)
+{
+  Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    sink = map.eraseIf([](const typename Map::value_type& item) { return item.first % 4 == 0; });
+  });
+}
+
+template <typename Map>
+double popMin(const Keys& keys, const Keys&)
+{
+  Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    Value sum = 0;
+    while (!map.isEmpty())
+      sum += map.popMin().second;
+    sink = sum;
+  });
+}
+
+template <typename Map>
+double fromSorted(const Keys& keys, const Keys&)
+{
+  std::vector<std::pair<Key, Value>> items;
+  for (const auto key : keys)
+    items.emplace_back(key, key);
+  std::sort(items.begin(), items.end());
+  return nanosecondsPerOperation(items.size(), [&]() {
+    const Map map = Map::fromSorted(items.begin(), items.end());
+    sink = map.getSize();
+  });
+}
+
+template <typename Map>
+double bulkLoad(const Keys& keys, const Keys&)
+{
+  std::vector<std::pair<Key, Value>> items;
+  for (const auto key : keys)
+    items.emplace_back(key, key);
+  return nanosecondsPerOperation(items.size(), [&]() {
+    const Map map = Map::bulkLoad(items.begin(), items.end());
+    sink = map.getSize();
+  });
+}
+
+template <typename Map>
+double merge(const Keys& keys, const Keys& missing)
+{
+  Map map = makeMap<Map>(keys);
+  Map other = makeMap<Map>(missing);
+  return nanosecondsPerOperation(keys.size() + missing.size(), [&]() {
+    map.merge(std::move(other));
+    sink = map.getSize();
+  });
+}
+
+// Every insert makes a new version of a persistent map and drops the previous one.
+template <typename Map>
+double insertVersions(const Keys& keys, const Keys&)
+{
+  Map map;
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    for (const auto key : keys)
+      map = map.insert(key, key);
+  });
+}
+
+template <typename Map>
+double findInVersion(const Keys& keys, const Keys&)
+{
+  Map map;
+  for (const auto key : keys)
+    map = map.insert(key, key);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    Value sum = 0;
+    for (const auto key : keys)
+      sum += map.valueOf(key);
+    sink = sum;
+  });
+}
+
+template <typename Map>
+double upsert(const Keys& keys, const Keys&)
+{
+  Map map;
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    for (const auto key : keys)
+      map.upsert(key, key);
+  });
+}
+
+template <typename Map>
+double findUpserted(const Keys& keys, const Keys&)
+{
+  Map map;
+  for (const auto key : keys)
+    map.upsert(key, key);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    Value sum = 0;
+    for (const auto key : keys)
+      sum += map.find(key)->second;
+    sink = sum;
+  });
+}
+
+// A map shared by threads through a single lock, the baseline for the concurrent maps.
+template <typename Map>
+class Locked
+{
+public:
+  void upsert(Key key, Value value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    map[key] = value;
+  }
+
+  typename Map::const_iterator find(Key key) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return map.find(key);
+  }
+
+  typename Map::const_iterator end() const
+  {
+    return map.end();
+  }
+
+private:
+  mutable std::mutex mutex;
+  Map map;
+};
+
+// Scalability: every thread runs keys.size() operations, nine lookups per upsert, on one
+// shared map; the time is per operation of all threads together, so it falls as long as
+// the map scales with the threads.
+template <typename Map, unsigned Threads>
+double mixed(const Keys& keys, const Keys&)
+{
+  Map map;
+  for (const auto key : keys)
+    map.upsert(key, key);
+  std::atomic<bool> start(false);
+  std::atomic<Value> hits(0);
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < Threads; ++t)
+    workers.emplace_back([&, t]() {
+      while (!start.load())
+        std::this_thread::yield();
+      Value found = 0;
+      for (std::size_t i = 0; i < keys.size(); ++i)
+      {
+        const Key key = keys[(i + t * keys.size() / Threads) % keys.size()];
+        if (i % 10 == 0)
+          map.upsert(key, i);
+        else
+          found += map.find(key) != map.end();
+      }
+      hits += found;
+    });
+  const double time = nanosecondsPerOperation(keys.size() * Threads, [&]() {
+    start = true;
+    for (auto& worker : workers)
+      worker.join();
+  });
+  sink = hits;
+  return time;
+}
+
+// Thread scaling depends on the cores and the scheduler, so it is not gated.
+template <typename Map>
+void addScalingBenchmarks(std::vector<Benchmark>& benchmarks, const std::string& prefix)
+{
+  benchmarks.push_back({ prefix + "/mixed@1", mixed<Map, 1>, false });
+  benchmarks.push_back({ prefix + "/mixed@2", mixed<Map, 2>, false });
+  benchmarks.push_back({ prefix + "/mixed@4", mixed<Map, 4>, false });
+  benchmarks.push_back({ prefix + "/mixed@8", mixed<Map, 8>, false });
+  benchmarks.push_back({ prefix + "/mixed@16", mixed<Map, 16>, false });
+  benchmarks.push_back({ prefix + "/mixed@32", mixed<Map, 32>, false });
+  benchmarks.push_back({ prefix + "/mixed@64", mixed<Map, 64>, false });
+}
+
+// Write-optimised maps take blind writes, which do not look the key up first.
+template <typename Map>
+double insertBlind(const Keys& keys, const Keys&)
+{
+  Map map;
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    for (const auto key : keys)
+      map.insert(key, key);
+  });
+}
+
+// Lookups in a map whose writes were all flushed and compacted.
+template <typename Map>
+double findWritten(const Keys& keys, const Keys&)
 {
-  Map<int, std::string> map;
-  map[1] = "TODO";
+  Map map;
+  for (const auto key : keys)
+    map.insert(key, key);
+  map.flush();
+  map.waitForCompaction();
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    Value sum = 0;
+    for (const auto key : keys)
+      sum += map.valueOf(key);
+    sink = sum;
+  });
+}
+
+template <typename Map>
+double findMissingWritten(const Keys& keys, const Keys& missing)
+{
+  Map map;
+  for (const auto key : keys)
+    map.insert(key, key);
+  map.flush();
+  map.waitForCompaction();
+  return nanosecondsPerOperation(missing.size(), [&]() {
+    Value hits = 0;
+    for (const auto key : missing)
+      hits += map.contains(key);
+    sink = hits;
+  });
+}
+
+// Lookups in the frozen copy of a Map of the keys.
+template <typename Map>
+double findFrozen(const Keys& keys, const Keys&)
+{
+  const auto frozen = aisdi::freeze(makeMap<Map>(keys));
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    Value sum = 0;
+    for (const auto key : keys)
+      sum += frozen.find(key)->second;
+    sink = sum;
+  });
+}
+
+template <typename Map>
+double findMissingFrozen(const Keys& keys, const Keys& missing)
+{
+  const auto frozen = aisdi::freeze(makeMap<Map>(keys));
+  return nanosecondsPerOperation(missing.size(), [&]() {
+    Value hits = 0;
+    for (const auto key : missing)
+      hits += frozen.find(key) != frozen.end();
+    sink = hits;
+  });
+}
+
+template <typename Map>
+double freeze(const Keys& keys, const Keys&)
+{
+  const Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    sink = aisdi::freeze(map).getSize();
+  });
+}
+
+// Counter workloads: every key is counted into one of size/8 groups, so most
+// operations update an existing counter.
+Key groupOf(Key key, std::size_t size)
+{
+  return key % (size / 8 + 1);
+}
+
+template <typename Map>
+double countIndex(const Keys& keys, const Keys&)
+{
+  Map map;
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    for (const auto key : keys)
+      map[groupOf(key, keys.size())] += 1;
+  });
+}
+
+template <typename Map>
+double countMerge(const Keys& keys, const Keys&)
+{
+  Map map;
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    for (const auto key : keys)
+      map.mergeValue(groupOf(key, keys.size()), 1, std::plus<Value>());
+  });
+}
+
+template <typename Map>
+double countMany(const Keys& keys, const Keys&)
+{
+  std::vector<std::pair<Key, Value>> items;
+  for (const auto key : keys)
+    items.emplace_back(groupOf(key, keys.size()), 1);
+  Map map;
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    map.upsertMany(items.begin(), items.end(), std::plus<Value>());
+  });
+}
+
+template <typename Map>
+double copy(const Keys& keys, const Keys&)
+{
+  const Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    const Map other(map);
+    sink = other.getSize();
+  });
+}
+
+template <typename Map>
+double snapshot(const Keys& keys, const Keys&)
+{
+  const Map map = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    const Map other = map.snapshot();
+    sink = other.getSize();
+  });
+}
+
+template <typename Map>
+double destroy(const Keys& keys, const Keys&)
+{
+  std::unique_ptr<Map> map(new Map(makeMap<Map>(keys)));
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    map.reset();
+  });
+}
+
+template <typename Map>
+double equal(const Keys& keys, const Keys&)
+{
+  const Map map = makeMap<Map>(keys);
+  const Map other = makeMap<Map>(keys);
+  return nanosecondsPerOperation(keys.size(), [&]() {
+    sink = map == other;
+  });
+}
+
+// Builds a map of Items keys after another and looks each key up once, the way code
+// holding many tiny maps uses them; the time is per key.
+template <typename Map, std::size_t Items>
+double tinyMaps(const Keys& keys, const Keys&)
+{
+  return nanosecondsPerOperation(keys.size() / Items * Items, [&]() {
+    Value sum = 0;
+    for (std::size_t first = 0; first + Items <= keys.size(); first += Items)
+    {
+      Map map;
+      for (std::size_t i = first; i < first + Items; ++i)
+        map[keys[i]] = keys[i];
+      for (std::size_t i = first; i < first + Items; ++i)
+        sum += map.find(keys[i])->second;
+    }
+    sink = sum;
+  });
+}
+
+template <typename Map>
+void addTinyBenchmarks(std::vector<Benchmark>& benchmarks, const std::string& prefix)
+{
+  benchmarks.push_back({ prefix + "/tiny4", tinyMaps<Map, 4> });
+  benchmarks.push_back({ prefix + "/tiny16", tinyMaps<Map, 16> });
+}
+
+template <typename Map>
+void addBenchmarks(std::vector<Benchmark>& benchmarks, const std::string& prefix)
+{
+  benchmarks.push_back({ prefix + "/insert", insert<Map> });
+  benchmarks.push_back({ prefix + "/find", find<Map> });
+  benchmarks.push_back({ prefix + "/findMissing", findMissing<Map> });
+  benchmarks.push_back({ prefix + "/iterate", iterate<Map> });
+  benchmarks.push_back({ prefix + "/copy", copy<Map> });
+  benchmarks.push_back({ prefix + "/equal", equal<Map> });
+  benchmarks.push_back({ prefix + "/destroy", destroy<Map> });
+}
+
+std::vector<Benchmark> allBenchmarks()
+{
+  std::vector<Benchmark> benchmarks;
+  addBenchmarks<aisdi::TreeMap<Key, Value>>(benchmarks, "TreeMap");
+  benchmarks.push_back({ "TreeMap/findNear", findNear<aisdi::TreeMap<Key, Value>, false> });
+  benchmarks.push_back({ "TreeMap/findNearFinger", findNear<aisdi::TreeMap<Key, Value>, true> });
+  benchmarks.push_back({ "TreeMap/remove", remove<aisdi::TreeMap<Key, Value>> });
+  benchmarks.push_back({ "TreeMap/snapshot", snapshot<aisdi::TreeMap<Key, Value>> });
+  benchmarks.push_back({ "TreeMap/popMin", popMin<aisdi::TreeMap<Key, Value>> });
+  benchmarks.push_back({ "TreeMap/fromSorted", fromSorted<aisdi::TreeMap<Key, Value>> });
+  benchmarks.push_back({ "TreeMap/bulkLoad", bulkLoad<aisdi::TreeMap<Key, Value>> });
+  benchmarks.push_back({ "TreeMap/append", append<aisdi::TreeMap<Key, Value>> });
+  benchmarks.push_back({ "TreeMap/merge", merge<aisdi::TreeMap<Key, Value>> });
+  benchmarks.push_back({ "FilteredTreeMap/insert", insert<aisdi::FilteredTreeMap<Key, Value>> });
+  benchmarks.push_back({ "FilteredTreeMap/find", find<aisdi::FilteredTreeMap<Key, Value>> });
+  benchmarks.push_back({ "FilteredTreeMap/findMissing", findMissing<aisdi::FilteredTreeMap<Key, Value>> });
+  benchmarks.push_back({ "PersistentTreeMap/insert", insertVersions<aisdi::PersistentTreeMap<Key, Value>> });
+  benchmarks.push_back({ "PersistentTreeMap/find", findInVersion<aisdi::PersistentTreeMap<Key, Value>> });
+  benchmarks.push_back({ "SkipListMap/insert", upsert<aisdi::SkipListMap<Key, Value>> });
+  benchmarks.push_back({ "SkipListMap/find", findUpserted<aisdi::SkipListMap<Key, Value>> });
+  benchmarks.push_back({ "LsmMap/insert", insertBlind<aisdi::LsmMap<Key, Value>> });
+  benchmarks.push_back({ "LsmMap/find", findWritten<aisdi::LsmMap<Key, Value>> });
+  benchmarks.push_back({ "LsmMap/findMissing", findMissingWritten<aisdi::LsmMap<Key, Value>> });
+  addBenchmarks<aisdi::FlatMap<Key, Value>>(benchmarks, "FlatMap");
+  benchmarks.push_back({ "FlatMap/remove", remove<aisdi::FlatMap<Key, Value>> });
+  addBenchmarks<aisdi::RadixTreeMap<Key, Value>>(benchmarks, "RadixTreeMap");
+  benchmarks.push_back({ "RadixTreeMap/remove", remove<aisdi::RadixTreeMap<Key, Value>> });
+  addScalingBenchmarks<aisdi::SkipListMap<Key, Value>>(benchmarks, "SkipListMap");
+  addScalingBenchmarks<Locked<aisdi::TreeMap<Key, Value>>>(benchmarks, "LockedTreeMap");
+  addBenchmarks<aisdi::HashMap<Key, Value>>(benchmarks, "HashMap");
+  benchmarks.push_back({ "HashMap/remove", remove<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "HashMap/snapshot", snapshot<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "FilteredHashMap/insert", insert<aisdi::FilteredHashMap<Key, Value>> });
+  benchmarks.push_back({ "FilteredHashMap/find", find<aisdi::FilteredHashMap<Key, Value>> });
+  benchmarks.push_back({ "FilteredHashMap/findMissing", findMissing<aisdi::FilteredHashMap<Key, Value>> });
+  benchmarks.push_back({ "HashMap/eraseIf", eraseIf<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "HashMap/countIndex", countIndex<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "HashMap/countMerge", countMerge<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "HashMap/countMany", countMany<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "FrozenMap/find", findFrozen<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "FrozenMap/findMissing", findMissingFrozen<aisdi::HashMap<Key, Value>> });
+  benchmarks.push_back({ "HashMap/freeze", freeze<aisdi::HashMap<Key, Value>> });
+  addTinyBenchmarks<aisdi::TreeMap<Key, Value>>(benchmarks, "TreeMap");
+  addTinyBenchmarks<aisdi::SmallTreeMap<Key, Value>>(benchmarks, "SmallTreeMap");
+  addTinyBenchmarks<aisdi::HashMap<Key, Value>>(benchmarks, "HashMap");
+  addTinyBenchmarks<aisdi::SmallHashMap<Key, Value>>(benchmarks, "SmallHashMap");
+  return benchmarks;
+}
+
+double median(std::vector<double> samples)
+{
+  std::sort(samples.begin(), samples.end());
+  const auto middle = samples.size() / 2;
+  if (samples.size() % 2 == 0)
+    return (samples[middle - 1] + samples[middle]) / 2;
+  return samples[middle];
+}
+
+struct Options
+{
+  std::size_t size = 10000;
+  std::size_t repetitions = 15;
+  std::string filter;
+  std::vector<std::string> only;
+  bool gatedOnly = false;
+  bool json = false;
+};
+
+void printUsage(const char* program)
+{
+  std::cerr << "usage: " << program
+            << " [--json] [--size N] [--repetitions N] [--filter TEXT] [--only NAME,...] [--gated]\n";
+}
+
+std::vector<std::string> split(const std::string& text, char separator)
+{
+  std::vector<std::string> parts;
+  std::string::size_type begin = 0;
+  while (begin <= text.size())
+  {
+    auto end = text.find(separator, begin);
+    if (end == std::string::npos)
+      end = text.size();
+    if (end > begin)
+      parts.push_back(text.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return parts;
+}
+
+bool selected(const Options& options, const Benchmark& benchmark)
+{
+  const std::string& name = benchmark.name;
+  if (name.find(options.filter) == std::string::npos || (options.gatedOnly && !benchmark.gated))
+    return false;
+  return options.only.empty()
+         || std::find(options.only.begin(), options.only.end(), name) != options.only.end();
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--json") == 0)
+      options.json = true;
+    else if (std::strcmp(argv[i], "--size") == 0 && hasValue)
+      options.size = std::atoll(argv[++i]);
+    else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue)
+      options.repetitions = std::atoll(argv[++i]);
+    else if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+      options.filter = argv[++i];
+    else if (std::strcmp(argv[i], "--only") == 0 && hasValue)
+      options.only = split(argv[++i], ',');
+    else if (std::strcmp(argv[i], "--gated") == 0)
+      options.gatedOnly = true;
+    else
+      return false;
+  }
+  return options.size > 0 && options.repetitions > 0;
 }
 
 } // namespace
 
 int main(int argc, char** argv)
 {
-  const std::size_t repeatCount = argc > 1 ? std::atoll(argv[1]) : 10000;
-  for (std::size_t i = 0; i < repeatCount; ++i)
-    perfomTest();
-  return 0;
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Present keys are the even numbers, missing ones the odd numbers, both shuffled
+  // with a fixed seed so that every run measures exactly the same workload.
+  Keys keys(options.size);
+  Keys missing(options.size);
+  for (std::size_t i = 0; i < options.size; ++i)
+  {
+    keys[i] = 2 * i;
+    missing[i] = 2 * i + 1;
+  }
+  std::mt19937_64 generator(20161112);
+  std::shuffle(keys.begin(), keys.end(), generator);
+  std::shuffle(missing.begin(), missing.end(), generator);
+
+  if (options.json)
+    std::cout << "{\n  \"size\": " << options.size
+              << ",\n  \"repetitions\": " << options.repetitions
+              << ",\n  \"unit\": \"ns/op\",\n  \"benchmarks\": {";
+
+  std::vector<Benchmark> benchmarks;
+  for (const auto& benchmark : allBenchmarks())
+    if (selected(options, benchmark))
+      benchmarks.push_back(benchmark);
+
+  // Repetitions are interleaved across benchmarks (after one discarded warm-up
+  // round), so slow drifts of the machine state spread evenly over all samples.
+  std::vector<std::vector<double>> samples(benchmarks.size());
+  for (std::size_t round = 0; round <= options.repetitions; ++round)
+    for (std::size_t i = 0; i < benchmarks.size(); ++i)
+    {
+      const double sample = benchmarks[i].run(keys, missing);
+      if (round > 0)
+        samples[i].push_back(sample);
+    }
+
+  for (std::size_t i = 0; i < benchmarks.size(); ++i)
+  {
+    if (options.json)
+    {
+      std::cout << (i == 0 ? "\n" : ",\n") << "    \"" << benchmarks[i].name << "\": [";
+      for (std::size_t j = 0; j < samples[i].size(); ++j)
+        std::cout << (j == 0 ? "" : ", ") << samples[i][j];
+      std::cout << "]";
+    }
+    else
+    {
+      std::cout << benchmarks[i].name << ": median " << median(samples[i])
+                << " ns/op, min " << *std::min_element(samples[i].begin(), samples[i].end())
+                << " ns/op\n";
+    }
+  }
+
+  if (options.json)
+    std::cout << "\n  }\n}\n";
+  return EXIT_SUCCESS;
 }
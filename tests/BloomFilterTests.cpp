@@ -0,0 +1,48 @@
+#include <BloomFilter.h>
+
+#include <cstdint>
+#include <random>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(BloomFiltersTests)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyFilter_WhenLookingUp_ThenNothingMayBePresent)
+{
+  const aisdi::BloomFilter filter(100);
+
+  for (std::uint64_t hash = 0; hash < 1000; ++hash)
+    BOOST_REQUIRE(!filter.mayContain(hash));
+  BOOST_CHECK_EQUAL(filter.getCapacity(), 100u);
+  BOOST_CHECK(filter.getBitCount() >= 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFilledFilter_WhenLookingUp_ThenAllInsertedAndFewOthersMayBePresent)
+{
+  std::mt19937_64 random(49);
+  const std::uint64_t keys = 10000;
+  aisdi::BloomFilter filter(keys);
+  //consecutive integers, the way std::hash leaves them
+  for (std::uint64_t key = 0; key < keys; ++key)
+    filter.insert(key);
+
+  for (std::uint64_t key = 0; key < keys; ++key)
+    BOOST_REQUIRE(filter.mayContain(key));
+  std::uint64_t falsePositives = 0;
+  for (int i = 0; i < 100000; ++i)
+    falsePositives += filter.mayContain(keys + random() % (UINT64_MAX - keys));
+  BOOST_CHECK_LT(falsePositives, 3000u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFilledFilter_WhenCleared_ThenItIsEmpty)
+{
+  aisdi::BloomFilter filter(10);
+  filter.insert(42);
+  BOOST_CHECK(filter.mayContain(42));
+
+  filter.clear();
+
+  BOOST_CHECK(!filter.mayContain(42));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
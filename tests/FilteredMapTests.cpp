@@ -0,0 +1,177 @@
+#include <FilteredMap.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedMapTypes = boost::mpl::list<aisdi::FilteredTreeMap<std::int32_t, std::string>,
+                                        aisdi::FilteredHashMap<std::int32_t, std::string>,
+                                        aisdi::FilteredTreeMap<std::string, std::string>,
+                                        aisdi::FilteredHashMap<std::string, std::string>>;
+
+template <typename K>
+K keyOf(int i)
+{
+  return static_cast<K>(i);
+}
+
+template <>
+std::string keyOf<std::string>(int i)
+{
+  return std::to_string(i);
+}
+
+BOOST_AUTO_TEST_SUITE(FilteredMapsTests)
+
+template <typename Map>
+void thenMapContainsItems(const Map& map, const std::map<typename Map::key_type, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+  }
+  std::size_t iterated = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++iterated;
+  BOOST_CHECK_EQUAL(iterated, expected.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenLookingUp_ThenFilterAnswers,
+                              Map,
+                              TestedMapTypes)
+{
+  using K = typename Map::key_type;
+  const Map map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.find(keyOf<K>(1)) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(keyOf<K>(1)), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.getStats().lookups, 2u);
+  BOOST_CHECK_EQUAL(map.getStats().filtered, 2u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAddingAndRemovingItems_ThenItBehavesLikeTheMapBehindIt,
+                              Map,
+                              TestedMapTypes)
+{
+  using K = typename Map::key_type;
+  Map map = { { keyOf<K>(42), "Alice" }, { keyOf<K>(27), "Bob" }, { keyOf<K>(13), "Chuck" } };
+
+  map[keyOf<K>(7)] = "Dave";
+  map[keyOf<K>(42)] = "Eve";
+  map.remove(keyOf<K>(27));
+  BOOST_CHECK_THROW(map.remove(keyOf<K>(27)), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(keyOf<K>(28)), std::out_of_range);
+  map.remove(map.find(keyOf<K>(13)));
+
+  thenMapContainsItems(map, { { keyOf<K>(7), "Dave" }, { keyOf<K>(42), "Eve" } });
+  Map copy(map);
+  BOOST_CHECK(copy == map);
+  copy[keyOf<K>(1)] = "Frank";
+  BOOST_CHECK(copy != map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopyOfMap_WhenWritingThroughValueOf_ThenOnlyMapChanges,
+                              Map,
+                              TestedMapTypes)
+{
+  using K = typename Map::key_type;
+  Map map = { { keyOf<K>(1), "Alice" }, { keyOf<K>(2), "Bob" } };
+  const Map copy(map);
+
+  map.valueOf(keyOf<K>(1)) = "Eve";
+  BOOST_CHECK_THROW(map.valueOf(keyOf<K>(3)), std::out_of_range);
+
+  BOOST_CHECK_EQUAL(map.valueOf(keyOf<K>(1)), "Eve");
+  BOOST_CHECK_EQUAL(copy.valueOf(keyOf<K>(1)), "Alice");
+  BOOST_CHECK(copy != map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFilledMapOrRange_WhenWrapped_ThenFilterKnowsAllKeys,
+                              Map,
+                              TestedMapTypes)
+{
+  using K = typename Map::key_type;
+  std::map<K, std::string> expected;
+  typename Map::map_type inner;
+  for (int i = 0; i < 500; ++i)
+    inner[keyOf<K>(i)] = expected[keyOf<K>(i)] = std::to_string(i);
+
+  const Map wrapped(std::move(inner));
+  const Map ranged(expected.begin(), expected.end());
+
+  thenMapContainsItems(wrapped, expected);
+  thenMapContainsItems(ranged, expected);
+  BOOST_CHECK(wrapped.find(keyOf<K>(1000)) == wrapped.end());
+  BOOST_CHECK(ranged == wrapped);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyItems_WhenFilterGrows_ThenAllAreFoundAndMissesAreFiltered,
+                              Map,
+                              TestedMapTypes)
+{
+  using K = typename Map::key_type;
+  Map map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 5000; ++i)
+    map[keyOf<K>(2 * i)] = expected[keyOf<K>(2 * i)] = std::to_string(i);
+  thenMapContainsItems(map, expected);
+
+  map.resetStats();
+  for (int i = 0; i < 5000; ++i)
+    BOOST_REQUIRE(map.find(keyOf<K>(2 * i + 1)) == map.end());
+
+  const aisdi::FilterStats& stats = map.getStats();
+  BOOST_CHECK_EQUAL(stats.lookups, 5000u);
+  BOOST_CHECK_EQUAL(stats.filtered + stats.falsePositives, 5000u);
+  BOOST_CHECK_LT(stats.falsePositiveRate(), 0.05);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRemovedKeys_WhenRebuilt_ThenFilterForgetsThem,
+                              Map,
+                              TestedMapTypes)
+{
+  using K = typename Map::key_type;
+  Map map;
+  for (int i = 0; i < 1000; ++i)
+    map[keyOf<K>(i)] = "x";
+  for (int i = 0; i < 1000; i += 2)
+    map.remove(keyOf<K>(i));
+
+  map.rebuild();
+  map.resetStats();
+  for (int i = 0; i < 1000; i += 2)
+    BOOST_REQUIRE(map.find(keyOf<K>(i)) == map.end());
+  for (int i = 1; i < 1000; i += 2)
+    BOOST_REQUIRE(map.find(keyOf<K>(i)) != map.end());
+
+  BOOST_CHECK_LT(map.getStats().falsePositives, 25u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenChurningKeys_WhenRemovalsFillFilter_ThenItIsRebuiltAutomatically)
+{
+  aisdi::FilteredHashMap<int, int> map;
+  for (int i = 0; i < 10000; ++i)
+  {
+    map[i] = i;
+    map.remove(i);
+  }
+  map[-1] = -1;
+
+  for (int i = 0; i < 10000; ++i)
+    BOOST_REQUIRE(map.find(i) == map.end());
+
+  //without rebuilds all 10000 removed keys would still pass the filter
+  BOOST_CHECK_LT(map.getStats().falsePositiveRate(), 0.1);
+  BOOST_CHECK_EQUAL(map.valueOf(-1), -1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,199 @@
+#include <FlatMap.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::FlatMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(FlatMapsTests)
+
+template <typename Map, typename Expected>
+void thenMapIsIteratedInOrder(const Map& map, const Expected& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (const auto& item : expected)
+    BOOST_CHECK(map.valueOf(item.first) == item.second);
+
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK(it->first == item.first);
+    BOOST_CHECK((*it).second == item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreated_ThenItHasNoItems,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK(map.lower_bound(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAddingAndRemovingItems_ThenItIsIteratedInKeyOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" }, { 42, "Dave" } };
+
+  map[7] = "Eve";
+  map[42] = "Frank";
+  map.remove(27);
+  BOOST_CHECK_THROW(map.remove(27), std::out_of_range);
+
+  thenMapIsIteratedInOrder(map, std::map<K, std::string>{ { 7, "Eve" }, { 13, "Chuck" }, { 42, "Frank" } });
+  BOOST_CHECK_EQUAL(map.lower_bound(8)->first, 13u);
+  BOOST_CHECK_EQUAL((--map.end())->second, "Frank");
+}
+
+BOOST_AUTO_TEST_CASE(GivenBufferedItems_WhenLookingUpAndRemoving_ThenTheyBehaveLikeSortedOnes)
+{
+  aisdi::FlatMap<int, int> map;
+  for (int i = 0; i < 100; ++i)
+    map[i * 2] = i;
+  map.flush();
+  //fewer than sqrt(100) new keys stay in the buffer
+  map[51] = 1;
+  map[5] = 2;
+  map[301] = 3;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 103u);
+  BOOST_CHECK_EQUAL(map.valueOf(51), 1);
+  map.remove(5);
+  map.remove(50);
+  BOOST_CHECK_THROW(map.valueOf(5), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.find(51)->second, 1);
+
+  std::vector<int> keys;
+  for (const auto& item : map)
+    keys.push_back(item.first);
+  BOOST_CHECK_EQUAL(keys.size(), 101u);
+  BOOST_CHECK(std::is_sorted(keys.begin(), keys.end()));
+  BOOST_CHECK_EQUAL(keys.back(), 301);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyRandomUpdates_WhenBufferIsMergedRepeatedly_ThenMapMatchesStdMap)
+{
+  std::mt19937 random(5);
+  aisdi::FlatMap<std::uint64_t, std::uint64_t> map;
+  std::map<std::uint64_t, std::uint64_t> expected;
+  for (int i = 0; i < 30000; ++i)
+  {
+    const std::uint64_t key = random() % 5000;
+    const unsigned operation = random() % 4;
+    if (operation == 0)
+    {
+      if (expected.erase(key) != 0)
+        map.remove(key);
+      else
+        BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+    }
+    else if (operation == 1)
+    {
+      const auto it = expected.find(key);
+      BOOST_REQUIRE(it == expected.end() ? map.find(key) == map.end() : map.valueOf(key) == it->second);
+    }
+    else
+      map[key] = expected[key] = i;
+  }
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenWritingThroughIterators_ThenValuesChange)
+{
+  aisdi::FlatMap<int, std::string> map = { { 1, "a" }, { 2, "b" } };
+  map[3] = "c";
+
+  for (auto it = map.begin(); it != map.end(); ++it)
+    it->second += "!";
+  map.find(2)->second = "B";
+
+  thenMapIsIteratedInOrder(map, std::map<int, std::string>{ { 1, "a!" }, { 2, "B" }, { 3, "c!" } });
+  const auto next = map.remove(map.find(1));
+  BOOST_CHECK_EQUAL(next->first, 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenReversedComparator_WhenIterating_ThenKeysAreDescending)
+{
+  aisdi::FlatMap<int, int, std::greater<int>> map;
+  for (int i = 0; i < 10; ++i)
+    map[i] = i * i;
+
+  int expectedKey = 9;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expectedKey);
+    BOOST_CHECK_EQUAL(item.second, expectedKey * expectedKey);
+    --expectedKey;
+  }
+  BOOST_CHECK_EQUAL(map.lower_bound(4)->first, 4);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEqualItemsBufferedDifferently_WhenComparing_ThenMapsAreEqual)
+{
+  aisdi::FlatMap<int, int> map;
+  aisdi::FlatMap<int, int> other;
+  for (int i = 0; i < 50; ++i)
+  {
+    map[i] = i;
+    other[49 - i] = 49 - i;
+  }
+
+  BOOST_CHECK(map == other);
+  other[3] = 0;
+  BOOST_CHECK(map != other);
+}
+
+//a key type without operator==, ordered ignoring case
+struct Name
+{
+  std::string text;
+};
+
+struct CaseInsensitiveLess
+{
+  bool operator()(const Name& a, const Name& b) const
+  {
+    return std::lexicographical_compare(a.text.begin(), a.text.end(), b.text.begin(), b.text.end(),
+                                        [](char x, char y) { return std::tolower(x) < std::tolower(y); });
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenMapsWithKeysEqualByComparator_WhenComparing_ThenMapsAreEqual)
+{
+  aisdi::FlatMap<Name, int, CaseInsensitiveLess> map;
+  aisdi::FlatMap<Name, int, CaseInsensitiveLess> other;
+  map[Name{ "alice" }] = 1;
+  map[Name{ "Bob" }] = 2;
+  other[Name{ "BOB" }] = 2;
+  other[Name{ "Alice" }] = 1;
+
+  BOOST_CHECK(map == other);
+  other[Name{ "Chuck" }] = 3;
+  map[Name{ "Dave" }] = 3;
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,121 @@
+#include <FrozenMap.h>
+#include <HashMap.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(FrozenMapsTests)
+
+template <typename Frozen, typename Map>
+void thenFrozenMapHasItemsOf(const Frozen& frozen, const Map& map)
+{
+  BOOST_CHECK_EQUAL(frozen.getSize(), map.getSize());
+  for (const auto& item : map)
+  {
+    const auto it = frozen.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != frozen.end(), "Missing required item with key: " << item.first);
+    BOOST_REQUIRE(it->second == item.second);
+    BOOST_REQUIRE(frozen.valueOf(item.first) == item.second);
+  }
+  std::size_t iterated = 0;
+  for (auto it = frozen.begin(); it != frozen.end(); ++it)
+  {
+    BOOST_REQUIRE(map.valueOf(it->first) == it->second);
+    ++iterated;
+  }
+  BOOST_CHECK_EQUAL(iterated, map.getSize());
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyHashMap_WhenFrozen_ThenFrozenMapIsEmpty)
+{
+  const aisdi::HashMap<int, std::string> map;
+
+  const auto frozen = aisdi::freeze(map);
+
+  BOOST_CHECK(frozen.isEmpty());
+  BOOST_CHECK(frozen.begin() == frozen.end());
+  BOOST_CHECK(frozen.find(1) == frozen.end());
+  BOOST_CHECK_THROW(frozen.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(--frozen.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenHashMap_WhenFrozen_ThenEveryItemIsFoundAndMissingKeysAreNot)
+{
+  aisdi::HashMap<std::string, std::string> map = { { "Alice", "1" }, { "Bob", "2" }, { "Chuck", "3" } };
+  map["Dave"] = "4";
+
+  const auto frozen = aisdi::freeze(map);
+  map["Eve"] = "5";
+  map.remove("Alice");
+
+  BOOST_CHECK_EQUAL(frozen.getSize(), 4u);
+  BOOST_CHECK_EQUAL(frozen.valueOf("Alice"), "1");
+  BOOST_CHECK_EQUAL(frozen.find("Dave")->second, "4");
+  BOOST_CHECK(frozen.find("Eve") == frozen.end());
+  BOOST_CHECK(frozen.find("") == frozen.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyItems_WhenFrozen_ThenTheyAllGetTheirOwnSlot)
+{
+  std::mt19937_64 random(50);
+  for (std::size_t size : { 1, 2, 3, 5, 17, 1000, 100000 })
+  {
+    aisdi::HashMap<std::uint64_t, std::uint64_t> map;
+    while (map.getSize() < size)
+      map[random()] = random();
+
+    const auto frozen = aisdi::freeze(map);
+
+    thenFrozenMapHasItemsOf(frozen, map);
+    for (int i = 0; i < 1000; ++i)
+    {
+      const std::uint64_t key = random();
+      BOOST_REQUIRE((frozen.find(key) == frozen.end()) == (map.find(key) == map.end()));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenRangeWithRepeatedKeys_WhenBuilt_ThenLastValueWins)
+{
+  const std::vector<std::pair<int, int>> items = { { 1, 10 }, { 2, 20 }, { 1, 11 }, { 3, 30 }, { 1, 12 } };
+
+  const aisdi::FrozenMap<int, int> frozen(items.begin(), items.end());
+
+  BOOST_CHECK_EQUAL(frozen.getSize(), 3u);
+  BOOST_CHECK_EQUAL(frozen.valueOf(1), 12);
+  BOOST_CHECK_EQUAL(frozen.valueOf(2), 20);
+  BOOST_CHECK_EQUAL(frozen.valueOf(3), 30);
+}
+
+struct ConstantHash
+{
+  std::size_t operator()(int) const
+  {
+    return 7;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenDistinctKeysOfEqualHashes_WhenBuilt_ThenItThrows)
+{
+  const std::vector<std::pair<int, int>> items = { { 1, 10 }, { 2, 20 } };
+
+  BOOST_CHECK_THROW((aisdi::FrozenMap<int, int, ConstantHash>(items.begin(), items.end())), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapsWithSameItemsInDifferentOrder_WhenComparing_ThenTheyAreEqual)
+{
+  const aisdi::FrozenMap<int, int> frozen = { { 1, 1 }, { 2, 2 }, { 3, 3 }, { 4, 4 }, { 5, 5 } };
+  const aisdi::FrozenMap<int, int> reversed = { { 5, 5 }, { 4, 4 }, { 3, 3 }, { 2, 2 }, { 1, 1 } };
+  const aisdi::FrozenMap<int, int> changed = { { 1, 1 }, { 2, 2 }, { 3, 3 }, { 4, 4 }, { 5, 6 } };
+
+  BOOST_CHECK(frozen == reversed);
+  BOOST_CHECK(frozen != changed);
+  BOOST_CHECK((frozen != aisdi::FrozenMap<int, int>()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
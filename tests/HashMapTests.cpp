@@ -2,7 +2,12 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <map>
+#include <memory>
 
 #include <boost/test/unit_test.hpp>
 
@@ -591,6 +596,306 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithSameSizeAndDifferentKeys_WhenComparingThem_ThenTheyAreNotEqual,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const Map<K> other = { { 42, "Alice" }, { 28, "Bob" } };
+
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEqualMaps_WhenMoveAssigning_ThenAllElementsAreMoved,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+
+  other = std::move(map);
+
+  thenMapContainsItems(other, { { 42, "Alice" }, { 27, "Bob" } });
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsWithDifferentBucketCounts_WhenComparingThem_ThenOnlyContentMatters,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(7);
+  Map<K> other(13);
+  for (K i = 0; i < 50; ++i)
+  {
+    map[i] = std::to_string(i);
+    other[49 - i] = std::to_string(49 - i);
+  }
+
+  BOOST_CHECK(map == other);
+  other[3] = "changed";
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenLookingUpByStringView_ThenItemsAreFound)
+{
+  aisdi::HashMap<std::string, int> map = { { "Alice", 1 }, { "Bob", 2 }, { "Chuck", 3 } };
+  const std::string buffer = "Bob,Chuck";
+  const std::string_view bob = std::string_view(buffer).substr(0, 3);
+  const std::string_view chuck = std::string_view(buffer).substr(4);
+
+  BOOST_CHECK_EQUAL(map.valueOf(bob), 2);
+  BOOST_CHECK(map.find(chuck) == map.find(std::string("Chuck")));
+  BOOST_CHECK(map.find(std::string_view(buffer)) == map.end());
+  BOOST_CHECK_EQUAL(map.find("Alice")->second, 1);
+  BOOST_CHECK_THROW(map.valueOf("Dave"), std::out_of_range);
+
+  map.remove(bob);
+  BOOST_CHECK(map.find(bob) == map.end());
+  map.remove(map.find("Alice"));
+  BOOST_CHECK_EQUAL(map.getSize(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenUpserting_ThenExistingValuesAreUpdatedAndMissingInserted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+  const auto append = [](std::string& value) { value += "!"; };
+
+  BOOST_CHECK_EQUAL(map.upsert(42, "Bob", append), "Alice!");
+  BOOST_CHECK_EQUAL(map.upsert(27, "Bob", append), "Bob");
+  map.upsert(27, "Chuck", append);
+
+  thenMapContainsItems(map, { { 42, "Alice!" }, { 27, "Bob!" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenMergingValues_ThenCombinerGetsOldAndNewValue,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+  const auto join = [](std::string old, const std::string& value) { return old + "+" + value; };
+
+  map.mergeValue(42, "Bob", join);
+  map.mergeValue(27, "Chuck", join);
+  BOOST_CHECK_EQUAL(map.mergeValue(27, "Dave", join), "Chuck+Dave");
+
+  thenMapContainsItems(map, { { 42, "Alice+Bob" }, { 27, "Chuck+Dave" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenCounters_WhenUpsertingMany_ThenCountsAreAggregated)
+{
+  aisdi::HashMap<std::uint64_t, std::uint64_t> map;
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> items;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    items.emplace_back((i * 7) % 37, i);
+  map[5] = 1000000;
+
+  map.upsertMany(items.begin(), items.end(), [](std::uint64_t a, std::uint64_t b) { return a + b; });
+
+  std::map<std::uint64_t, std::uint64_t> expected = { { 5, 1000000 } };
+  for (const auto& item : items)
+    expected[item.first] += item.second;
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+}
+
+template <typename K>
+std::size_t countItems(const Map<K>& map)
+{
+  std::size_t count = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++count;
+  return count;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSharedBucket_WhenRemovingItsHead_ThenRemainingItemsAreStillFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(1);
+  map[1] = "Alice";
+  map[2] = "Bob";
+  map[3] = "Chuck";
+
+  map.remove(3);
+  thenMapContainsItems(map, { { 1, "Alice" }, { 2, "Bob" } });
+  BOOST_CHECK_EQUAL(countItems(map), 2u);
+  map.remove(2);
+  map.remove(1);
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenErasingWhileIterating_ThenNextIteratorIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(7);
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 100; ++i)
+  {
+    map[i] = std::to_string(i);
+    if (i % 3 != 0)
+      expected[i] = std::to_string(i);
+  }
+
+  std::size_t visited = 0;
+  for (auto it = map.begin(); it != map.end(); ++visited)
+    it = it->first % 3 == 0 ? map.erase(it) : ++it;
+
+  BOOST_CHECK_EQUAL(visited, 100u);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(countItems(map), 66u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenErasingByPredicate_ThenMatchingItemsAreRemoved,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(3);
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 100; ++i)
+  {
+    map[i] = std::to_string(i);
+    if (i % 4 != 1)
+      expected[i] = std::to_string(i);
+  }
+
+  const auto removed = map.eraseIf([](const std::pair<const K, std::string>& item) {
+    return item.first % 4 == 1;
+  });
+
+  BOOST_CHECK_EQUAL(removed, 25u);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(map == Map<K>(map));
+  BOOST_CHECK_EQUAL(map.eraseIf([](const std::pair<const K, std::string>&) { return true; }), 75u);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopiedMap_WhenModifyingEitherMap_ThenTheOtherIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(7);
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 50; ++i)
+    map[i] = expected[i] = std::to_string(i);
+
+  Map<K> copy(map);
+  Map<K> otherCopy = map;
+  std::map<K, std::string> expectedCopy = expected;
+  std::map<K, std::string> expectedOtherCopy = expected;
+
+  copy[1] = expectedCopy[1] = "one";
+  copy.remove(2);
+  expectedCopy.erase(2);
+  const auto first = copy.begin();
+  first->second = expectedCopy[first->first] = "first";
+
+  expectedOtherCopy.erase(otherCopy.cbegin()->first);
+  otherCopy.erase(otherCopy.cbegin());
+
+  map[100] = expected[100] = "hundred";
+  map.eraseIf([](const std::pair<const K, std::string>& item) { return item.first % 10 == 5; });
+  for (K i = 5; i < 50; i += 10)
+    expected.erase(i);
+
+  thenMapContainsItems(map, expected);
+  thenMapContainsItems(copy, expectedCopy);
+  thenMapContainsItems(otherCopy, expectedOtherCopy);
+  BOOST_CHECK_EQUAL(countItems(map), expected.size());
+  BOOST_CHECK_EQUAL(countItems(copy), expectedCopy.size());
+  BOOST_CHECK_EQUAL(countItems(otherCopy), expectedOtherCopy.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopyOfDestroyedMap_WhenUsingIt_ThenItemsAreStillThere,
+                              K,
+                              TestedKeyTypes)
+{
+  auto map = std::make_unique<Map<K>>(5);
+  for (K i = 0; i < 20; ++i)
+    (*map)[i] = std::to_string(i);
+  Map<K> copy;
+  copy = *map;
+  map.reset();
+
+  for (K i = 0; i < 20; ++i)
+    BOOST_CHECK_EQUAL(copy.valueOf(i), std::to_string(i));
+  copy[3] = "three";
+  BOOST_CHECK_EQUAL(copy.valueOf(3), "three");
+  BOOST_CHECK_EQUAL(countItems(copy), 20u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIteratorTakenBeforeWrite_WhenRemovingThroughIt_ThenCopyIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(7);
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 10; ++i)
+    map[i] = expected[i] = std::to_string(i);
+  const Map<K> copy(map);
+
+  const auto it = std::as_const(map).find(5);
+  map[12] = "twelve";
+  map.remove(it);
+
+  thenMapContainsItems(copy, expected);
+  BOOST_CHECK_EQUAL(countItems(copy), expected.size());
+  expected.erase(5);
+  expected[12] = "twelve";
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(countItems(map), expected.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenReferenceTakenBeforeCopy_WhenWritingThroughIt_ThenCopyIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "one" }, { 2, "two" } };
+  std::string& value = map[1];
+  const Map<K> copy(map);
+  Map<K> assigned;
+  assigned = map;
+
+  value = "changed";
+
+  BOOST_CHECK_EQUAL(map.valueOf(1), "changed");
+  BOOST_CHECK_EQUAL(copy.valueOf(1), "one");
+  BOOST_CHECK_EQUAL(assigned.valueOf(1), "one");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenModifyingMapThroughNewHandles_ThenSnapshotIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(7);
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 20; ++i)
+    map[i] = expected[i] = std::to_string(i);
+
+  const Map<K> snapshot = map.snapshot();
+  static_assert(!std::is_constructible<typename Map<K>::iterator, typename Map<K>::const_iterator>::value,
+                "only a non-const map turns a const_iterator into an iterator");
+  const auto converted = map.toIterator(std::as_const(map).find(3));
+  converted->second = "three";
+  const Map<K> otherSnapshot = map.snapshot();
+  map.remove(map.find(4));
+  map[30] = "thirty";
+
+  thenMapContainsItems(snapshot, expected);
+  BOOST_CHECK_EQUAL(countItems(snapshot), expected.size());
+  expected[3] = "three";
+  thenMapContainsItems(otherSnapshot, expected);
+  BOOST_CHECK_EQUAL(countItems(otherSnapshot), expected.size());
+  expected.erase(4);
+  expected[30] = "thirty";
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(countItems(map), expected.size());
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 
@@ -0,0 +1,176 @@
+#include <LsmMap.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(LsmMapsTests)
+
+template <typename Map, typename Expected>
+void thenMapContainsItems(const Map& map, const Expected& expected, std::uint64_t keys)
+{
+  for (std::uint64_t key = 0; key < keys; ++key)
+  {
+    const auto it = expected.find(key);
+    BOOST_REQUIRE_EQUAL(map.contains(key), it != expected.end());
+    if (it != expected.end())
+      BOOST_REQUIRE_EQUAL(map.valueOf(key), it->second);
+    else
+      BOOST_REQUIRE_THROW(map.valueOf(key), std::out_of_range);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenLookingUp_ThenNothingIsFound)
+{
+  const aisdi::LsmMap<int, std::string> map;
+
+  BOOST_CHECK(!map.contains(1));
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.getRunCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenItemsInMemtable_WhenOverwritingAndErasing_ThenLatestWriteWins)
+{
+  aisdi::LsmMap<int, std::string> map;
+
+  map.insert(42, "Alice");
+  map.insert(27, "Bob");
+  map.insert(42, "Eve");
+  map.erase(27);
+  map.erase(13);
+
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Eve");
+  BOOST_CHECK(!map.contains(27));
+  BOOST_CHECK(!map.contains(13));
+  BOOST_CHECK_EQUAL(map.getRunCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenItemsInOlderRuns_WhenShadowedByNewerWrites_ThenNewestIsFound)
+{
+  aisdi::LsmMap<std::string, int> map(4, 100);
+  map.insert("Alice", 1);
+  map.insert("Bob", 2);
+  map.flush();
+  map.insert("Alice", 3);
+  map.erase("Bob");
+  map.flush();
+  map.insert("Bob", 4);
+
+  BOOST_CHECK_EQUAL(map.getRunCount(), 2u);
+  BOOST_CHECK_EQUAL(map.valueOf("Alice"), 3);
+  BOOST_CHECK_EQUAL(map.valueOf("Bob"), 4);
+  map.erase("Bob");
+  BOOST_CHECK(!map.contains("Bob"));
+}
+
+BOOST_AUTO_TEST_CASE(GivenTooManyRuns_WhenCompacted_ThenOneRunKeepsLatestValuesWithoutTombstones)
+{
+  aisdi::LsmMap<int, int> map(8, 3);
+  for (int i = 0; i < 8; ++i)
+    map.insert(i, i);
+  for (int i = 0; i < 8; ++i)
+    map.insert(i, i % 2 == 0 ? i * 10 : i);
+  for (int i = 0; i < 4; ++i)
+    map.erase(i);
+  map.flush();
+
+  map.waitForCompaction();
+
+  BOOST_CHECK_EQUAL(map.getRunCount(), 1u);
+  thenMapContainsItems(map, std::map<int, int>{ { 4, 40 }, { 5, 5 }, { 6, 60 }, { 7, 7 } }, 10);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRunsErasingEverything_WhenCompacted_ThenNoRunIsLeft)
+{
+  aisdi::LsmMap<int, int> map(4, 2);
+  for (int i = 0; i < 4; ++i)
+    map.insert(i, i);
+  for (int i = 0; i < 4; ++i)
+    map.erase(i);
+
+  map.waitForCompaction();
+
+  BOOST_CHECK_EQUAL(map.getRunCount(), 0u);
+  BOOST_CHECK(!map.contains(0));
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyRandomWrites_WhenCompactingMeanwhile_ThenMapMatchesStdMap)
+{
+  std::mt19937_64 random(48);
+  aisdi::LsmMap<std::uint64_t, std::uint64_t> map(64, 3);
+  std::map<std::uint64_t, std::uint64_t> expected;
+  for (int round = 0; round < 5; ++round)
+  {
+    for (int i = 0; i < 5000; ++i)
+    {
+      const std::uint64_t key = random() % 2000;
+      if (random() % 4 == 0)
+      {
+        map.erase(key);
+        expected.erase(key);
+      }
+      else
+        map.insert(key, expected[key] = random());
+    }
+    //lookups race with the compaction of the runs just frozen
+    thenMapContainsItems(map, expected, 2000);
+  }
+  map.waitForCompaction();
+  thenMapContainsItems(map, expected, 2000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenReversedComparator_WhenLookingUpAcrossRuns_ThenItemsAreFound)
+{
+  aisdi::LsmMap<int, int, std::greater<int>> map(3, 2);
+  for (int i = 0; i < 20; ++i)
+    map.insert(i, -i);
+  map.erase(5);
+  map.flush();
+  map.waitForCompaction();
+
+  for (int i = 0; i < 20; ++i)
+    if (i == 5)
+      BOOST_CHECK(!map.contains(i));
+    else
+      BOOST_CHECK_EQUAL(map.valueOf(i), -i);
+}
+
+//the next failures comparisons throw, on whichever thread they run
+struct FailingLess
+{
+  static std::atomic<int> failures;
+
+  bool operator()(int a, int b) const
+  {
+    if (failures > 0 && failures-- > 0)
+      throw std::runtime_error("comparison failed");
+    return a < b;
+  }
+};
+
+std::atomic<int> FailingLess::failures(0);
+
+BOOST_AUTO_TEST_CASE(GivenThrowingComparator_WhenCompacting_ThenExceptionIsRethrownAndNextCompactionSucceeds)
+{
+  aisdi::LsmMap<int, int, FailingLess> map(100, 2);
+  map.insert(1, 10);
+  map.flush();
+  //a single item goes into the empty memtable without being compared
+  map.insert(2, 20);
+  FailingLess::failures = 1;
+  map.flush();
+
+  BOOST_CHECK_THROW(map.waitForCompaction(), std::runtime_error);
+  map.waitForCompaction();
+  BOOST_CHECK_EQUAL(map.getRunCount(), 1u);
+  BOOST_CHECK_EQUAL(map.valueOf(1), 10);
+  BOOST_CHECK_EQUAL(map.valueOf(2), 20);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
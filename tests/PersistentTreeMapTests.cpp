@@ -0,0 +1,172 @@
+#include <PersistentTreeMap.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::PersistentTreeMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(PersistentTreeMapsTests)
+
+template <typename K>
+void thenMapIsIteratedInOrder(const Map<K>& map, const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin(), map.end()));
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+
+  auto it = map.end();
+  for (auto expectedIt = expected.rbegin(); expectedIt != expected.rend(); ++expectedIt)
+  {
+    --it;
+    BOOST_CHECK_EQUAL(it->first, expectedIt->first);
+  }
+  BOOST_CHECK(it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreated_ThenItHasNoItems,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  BOOST_CHECK_THROW(map.min(), std::out_of_range);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInserting_ThenNewVersionHasItemAndOldIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  const Map<K> inserted = map.insert(13, "Chuck");
+  const Map<K> replaced = inserted.insert(42, "Dave");
+
+  thenMapIsIteratedInOrder(map, { { 27, "Bob" }, { 42, "Alice" } });
+  thenMapIsIteratedInOrder(inserted, { { 13, "Chuck" }, { 27, "Bob" }, { 42, "Alice" } });
+  thenMapIsIteratedInOrder(replaced, { { 13, "Chuck" }, { 27, "Bob" }, { 42, "Dave" } });
+  BOOST_CHECK_EQUAL(replaced.min().second, "Chuck");
+  BOOST_CHECK_EQUAL(replaced.max().second, "Dave");
+  BOOST_CHECK(replaced != inserted);
+  BOOST_CHECK(inserted.insert(42, "Alice") == inserted);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemoving_ThenNewVersionLacksItemAndOldIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  const Map<K> removed = map.remove(27);
+
+  thenMapIsIteratedInOrder(map, { { 13, "Chuck" }, { 27, "Bob" }, { 42, "Alice" } });
+  thenMapIsIteratedInOrder(removed, { { 13, "Chuck" }, { 42, "Alice" } });
+  BOOST_CHECK_THROW(removed.remove(27), std::out_of_range);
+  BOOST_CHECK(removed.remove(13).remove(42).isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyVersions_WhenUpdatingRandomly_ThenEveryVersionKeepsItsItems,
+                              K,
+                              TestedKeyTypes)
+{
+  std::mt19937 random(7);
+  std::vector<Map<K>> versions(1);
+  std::vector<std::map<K, std::string>> expected(1);
+  for (int i = 0; i < 2000; ++i)
+  {
+    const K key = static_cast<K>(random() % 300);
+    auto items = expected.back();
+    if (random() % 3 == 0 && items.count(key) != 0)
+    {
+      items.erase(key);
+      versions.push_back(versions.back().remove(key));
+    }
+    else
+    {
+      items[key] = std::to_string(i);
+      versions.push_back(versions.back().insert(key, std::to_string(i)));
+    }
+    expected.push_back(items);
+  }
+
+  for (std::size_t i = 0; i < versions.size(); i += 97)
+    thenMapIsIteratedInOrder(versions[i], expected[i]);
+  thenMapIsIteratedInOrder(versions.back(), expected.back());
+}
+
+BOOST_AUTO_TEST_CASE(GivenReversedComparator_WhenIterating_ThenKeysAreDescending)
+{
+  aisdi::PersistentTreeMap<int, int, std::greater<int>> map;
+  for (int i = 0; i < 10; ++i)
+    map = map.insert(i, i * i);
+
+  int expectedKey = 9;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expectedKey);
+    BOOST_CHECK_EQUAL(item.second, expectedKey * expectedKey);
+    --expectedKey;
+  }
+  BOOST_CHECK_EQUAL(map.find(4)->second, 16);
+}
+
+BOOST_AUTO_TEST_CASE(GivenPublishedVersions_WhenReadingConcurrently_ThenEveryVersionIsConsistent)
+{
+  using IntMap = aisdi::PersistentTreeMap<int, int>;
+  IntMap::Published latest;
+  std::atomic<bool> done(false);
+  std::atomic<int> inconsistent(0);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i)
+    readers.emplace_back([&]() {
+      std::size_t lastSize = 0;
+      while (!done.load())
+      {
+        //the writer publishes versions holding keys 0..n-1 mapped to themselves
+        const IntMap version = latest.load();
+        int expectedKey = 0;
+        for (const auto& item : version)
+          if (item.first != expectedKey++ || item.second != item.first)
+            ++inconsistent;
+        if (version.getSize() != static_cast<std::size_t>(expectedKey) || version.getSize() < lastSize)
+          ++inconsistent;
+        lastSize = version.getSize();
+      }
+    });
+
+  IntMap map;
+  for (int i = 0; i < 2000; ++i)
+  {
+    map = map.insert(i, i);
+    latest.store(map);
+  }
+  done = true;
+  for (auto& reader : readers)
+    reader.join();
+
+  BOOST_CHECK_EQUAL(inconsistent.load(), 0);
+  BOOST_CHECK(latest.load() == map);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,168 @@
+#include <RadixTreeMap.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::RadixTreeMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(RadixTreeMapsTests)
+
+template <typename Map, typename Expected>
+void thenMapIsIteratedInOrder(const Map& map, const Expected& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin(), map.end()));
+  for (const auto& item : expected)
+    BOOST_CHECK(map.valueOf(item.first) == item.second);
+
+  auto it = map.end();
+  for (auto expectedIt = expected.rbegin(); expectedIt != expected.rend(); ++expectedIt)
+  {
+    --it;
+    BOOST_CHECK(it->first == expectedIt->first);
+  }
+  BOOST_CHECK(it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreated_ThenItHasNoItems,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK(map.lower_bound(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAddingAndRemovingItems_ThenItIsIteratedInKeyOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  map[7] = "Dave";
+  map[42] = "Eve";
+  map.remove(27);
+  BOOST_CHECK_THROW(map.remove(27), std::out_of_range);
+
+  thenMapIsIteratedInOrder(map, std::map<K, std::string>{ { 7, "Dave" }, { 13, "Chuck" }, { 42, "Eve" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenSignedKeys_WhenIterating_ThenNegativeKeysComeFirst)
+{
+  aisdi::RadixTreeMap<std::int64_t, int> map;
+  for (std::int64_t key : std::vector<std::int64_t>{ 5, -1, 0, -300, 256, INT64_MIN, INT64_MAX })
+    map[key] = 1;
+
+  const std::vector<std::int64_t> expected = { INT64_MIN, -300, -1, 0, 5, 256, INT64_MAX };
+  std::vector<std::int64_t> keys;
+  for (const auto& item : map)
+    keys.push_back(item.first);
+  BOOST_CHECK(keys == expected);
+  BOOST_CHECK_EQUAL(map.lower_bound(-2)->first, -1);
+  BOOST_CHECK_EQUAL(map.lower_bound(6)->first, 256);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenSomeArePrefixesOfOthers_ThenAllAreKeptInOrder)
+{
+  aisdi::RadixTreeMap<std::string, int> map;
+  const std::vector<std::string> keys = { "romane", "romanus", "romulus", "rubens", "ruber",
+                                          "rubicon", "rubicundus", "rom", "r", "", std::string("rubicon\0x", 9) };
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    map[keys[i]] = static_cast<int>(i);
+
+  std::map<std::string, int> expected;
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    expected[keys[i]] = static_cast<int>(i);
+  thenMapIsIteratedInOrder(map, expected);
+
+  BOOST_CHECK_EQUAL(map.lower_bound("roma")->first, "romane");
+  BOOST_CHECK_EQUAL(map.lower_bound("rubicp")->first, "rubicundus");
+  BOOST_CHECK(map.lower_bound("s") == map.end());
+  BOOST_CHECK(map.find("roman") == map.end());
+
+  map.remove("rom");
+  map.remove("");
+  map.remove("romane");
+  expected.erase("rom");
+  expected.erase("");
+  expected.erase("romane");
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyRandomUpdates_WhenNodesGrowAndShrink_ThenMapMatchesStdMap)
+{
+  std::mt19937_64 random(11);
+  aisdi::RadixTreeMap<std::uint64_t, std::uint64_t> map;
+  std::map<std::uint64_t, std::uint64_t> expected;
+  for (int round = 0; round < 4; ++round)
+  {
+    //a small key space keeps the fan-out of the lower levels changing
+    const std::uint64_t mask = round % 2 == 0 ? 0x3ff : 0xff00ff;
+    for (int i = 0; i < 20000; ++i)
+    {
+      const std::uint64_t key = random() & mask;
+      if (random() % 3 == 0)
+      {
+        if (expected.erase(key) != 0)
+          map.remove(key);
+        else
+          BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+      }
+      else
+        map[key] = expected[key] = i;
+    }
+    thenMapIsIteratedInOrder(map, expected);
+    for (int i = 0; i < 1000; ++i)
+    {
+      const std::uint64_t key = random() & mask;
+      const auto it = map.lower_bound(key);
+      const auto expectedIt = expected.lower_bound(key);
+      BOOST_REQUIRE(expectedIt == expected.end() ? it == map.end() : it->first == expectedIt->first);
+    }
+  }
+
+  while (!map.isEmpty())
+    map.remove(map.begin());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenCopiedMap_WhenModifyingEitherMap_ThenTheOtherIsUnchanged)
+{
+  aisdi::RadixTreeMap<std::string, int> map;
+  for (int i = 0; i < 300; ++i)
+    map[std::to_string(i)] = i;
+
+  aisdi::RadixTreeMap<std::string, int> copy(map);
+  BOOST_CHECK(copy == map);
+  copy["x"] = 1;
+  map.remove("7");
+
+  BOOST_CHECK_EQUAL(copy.getSize(), 301u);
+  BOOST_CHECK_EQUAL(map.getSize(), 299u);
+  BOOST_CHECK_EQUAL(copy.valueOf("7"), 7);
+  BOOST_CHECK(map.find("x") == map.end());
+
+  map = copy;
+  BOOST_CHECK(map == copy);
+  aisdi::RadixTreeMap<std::string, int> moved(std::move(copy));
+  BOOST_CHECK(moved == map);
+  BOOST_CHECK(copy.isEmpty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
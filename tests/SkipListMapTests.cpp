@@ -0,0 +1,233 @@
+#include <SkipListMap.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::SkipListMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(SkipListMapsTests)
+
+template <typename K>
+void thenMapIsIteratedInOrder(const Map<K>& map, const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin(), map.end()));
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreated_ThenItHasNoItems,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK(map.lower_bound(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenUpserting_ThenItemsAreInsertedOrReplaced,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  BOOST_CHECK(map.upsert(13, "Chuck"));
+  BOOST_CHECK(!map.upsert(42, "Dave"));
+  map.upsert(27, "", [](std::string& value) { value += "by"; });
+  map.upsert(7, "Eve", [](std::string& value) { value += "!"; });
+
+  thenMapIsIteratedInOrder(map, { { 7, "Eve" }, { 13, "Chuck" }, { 27, "Bobby" }, { 42, "Dave" } });
+  BOOST_CHECK_EQUAL(map.find(13)->second, "Chuck");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemoving_ThenItemsAreGone,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  map.remove(27);
+  BOOST_CHECK_EQUAL(map.erase(27), 0u);
+  BOOST_CHECK_THROW(map.remove(27), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.erase(13), 1u);
+
+  thenMapIsIteratedInOrder(map, { { 42, "Alice" } });
+  map.remove(42);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSearchingLowerBound_ThenFirstNotSmallerKeyIsFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K i = 0; i < 100; i += 10)
+    map.upsert(i, std::to_string(i));
+  map.remove(50);
+
+  BOOST_CHECK_EQUAL(map.lower_bound(0)->first, 0u);
+  BOOST_CHECK_EQUAL(map.lower_bound(41)->first, 60u);
+  BOOST_CHECK_EQUAL(map.lower_bound(60)->first, 60u);
+  BOOST_CHECK(map.lower_bound(91) == map.end());
+
+  auto it = map.lower_bound(75);
+  BOOST_CHECK_EQUAL((it++)->first, 80u);
+  BOOST_CHECK_EQUAL(it->second, "90");
+  BOOST_CHECK(++it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenReversedComparator_WhenIterating_ThenKeysAreDescending)
+{
+  aisdi::SkipListMap<int, int, std::greater<int>> map;
+  for (int i = 0; i < 10; ++i)
+    map.upsert(i, i * i);
+
+  int expectedKey = 9;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expectedKey);
+    BOOST_CHECK_EQUAL(item.second, expectedKey * expectedKey);
+    --expectedKey;
+  }
+  BOOST_CHECK_EQUAL(map.lower_bound(4)->first, 4);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenInsertingDisjointKeys_ThenAllItemsArePresent)
+{
+  aisdi::SkipListMap<int, int> map;
+  const int threads = 8;
+  const int perThread = 2000;
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+    workers.emplace_back([&map, t]() {
+      for (int i = 0; i < perThread; ++i)
+        map.upsert(i * threads + t, t);
+    });
+  for (auto& worker : workers)
+    worker.join();
+
+  BOOST_CHECK_EQUAL(map.getSize(), static_cast<std::size_t>(threads * perThread));
+  int expectedKey = 0;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expectedKey);
+    BOOST_CHECK_EQUAL(item.second, expectedKey % threads);
+    ++expectedKey;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenUpdatingAndRemovingSharedKeys_ThenMapStaysConsistent)
+{
+  aisdi::SkipListMap<int, int> map;
+  const int keys = 256;
+  const int threads = 8;
+  std::atomic<int> outOfOrder(0);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+    workers.emplace_back([&, t]() {
+      for (int i = 0; i < 20000; ++i)
+      {
+        const int key = (i * 7 + t * 13) % keys;
+        if (t % 2 == 0)
+          map.upsert(key, 1, [](int& value) { ++value; });
+        else if (i % 3 == 0)
+          map.erase(key);
+        else if (i % 100 == 0)
+        {
+          int previous = -1;
+          for (const auto& item : map)
+          {
+            if (item.first <= previous)
+              ++outOfOrder;
+            previous = item.first;
+          }
+        }
+        else
+          map.find(key);
+      }
+    });
+  for (auto& worker : workers)
+    worker.join();
+
+  BOOST_CHECK_EQUAL(outOfOrder.load(), 0);
+  std::size_t count = 0;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK(item.second > 0);
+    ++count;
+  }
+  BOOST_CHECK_EQUAL(count, map.getSize());
+}
+
+//counts its live instances, to see whether replaced values get freed
+struct Counted
+{
+  static std::atomic<int> live;
+  int value;
+
+  Counted(int pValue = 0) : value(pValue)
+  {
+    ++live;
+  }
+
+  Counted(const Counted& other) : value(other.value)
+  {
+    ++live;
+  }
+
+  Counted& operator=(const Counted&) = default;
+
+  ~Counted()
+  {
+    --live;
+  }
+};
+
+std::atomic<int> Counted::live(0);
+
+BOOST_AUTO_TEST_CASE(GivenShortLivedThreads_WhenTheyReplaceValues_ThenValuesAreFreedAfterTheyExit)
+{
+  {
+    aisdi::SkipListMap<int, Counted> map;
+    //each thread retires fewer values than it takes to collect them itself
+    for (int t = 0; t < 64; ++t)
+    {
+      std::thread worker([&map, t]() {
+        for (int i = 0; i < 10; ++i)
+          map.upsert(t % 4, Counted(i));
+      });
+      worker.join();
+    }
+    BOOST_CHECK(Counted::live.load() >= 640);
+
+    for (int i = 0; i < 1000; ++i)
+      map.upsert(100, Counted(i));
+    //the main thread's values not freed yet, the 5 in the map and maybe a few orphans
+    BOOST_CHECK(Counted::live.load() < 200);
+    BOOST_CHECK_EQUAL(map.valueOf(3).value, 9);
+  }
+  BOOST_CHECK_EQUAL(Counted::live.load(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,203 @@
+#include <SmallMap.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedMapTypes = boost::mpl::list<aisdi::SmallTreeMap<std::int32_t, std::string, 4>,
+                                        aisdi::SmallHashMap<std::int32_t, std::string, 4>,
+                                        aisdi::SmallTreeMap<std::uint64_t, std::string, 4>,
+                                        aisdi::SmallHashMap<std::uint64_t, std::string, 4>>;
+
+BOOST_AUTO_TEST_SUITE(SmallMapsTests)
+
+template <typename Map>
+void thenMapContainsItems(const Map& map, const std::map<typename Map::key_type, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+  }
+  std::size_t iterated = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++iterated;
+  BOOST_CHECK_EQUAL(iterated, expected.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreated_ThenItIsInlineAndEmpty,
+                              Map,
+                              TestedMapTypes)
+{
+  const Map map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.isInline());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFullInlineMap_WhenAddingItem_ThenItIsPromotedWithAllItems,
+                              Map,
+                              TestedMapTypes)
+{
+  Map map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+  map[7] = "Dave";
+  map[42] = "Eve";
+  BOOST_CHECK(map.isInline());
+  thenMapContainsItems(map, { { 7, "Dave" }, { 13, "Chuck" }, { 27, "Bob" }, { 42, "Eve" } });
+
+  map[1] = "Frank";
+
+  BOOST_CHECK(!map.isInline());
+  thenMapContainsItems(map, { { 1, "Frank" }, { 7, "Dave" }, { 13, "Chuck" }, { 27, "Bob" }, { 42, "Eve" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenInlineMap_WhenRemovingItems_ThenOthersStay,
+                              Map,
+                              TestedMapTypes)
+{
+  Map map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  map.remove(27);
+  BOOST_CHECK_THROW(map.remove(27), std::out_of_range);
+  map.remove(map.find(42));
+  map[5] = "Dave";
+  map[6] = "Eve";
+
+  BOOST_CHECK(map.isInline());
+  thenMapContainsItems(map, { { 5, "Dave" }, { 6, "Eve" }, { 13, "Chuck" } });
+  while (!map.isEmpty())
+    map.remove(map.begin());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenWritingThroughIterators_ThenValuesChange,
+                              Map,
+                              TestedMapTypes)
+{
+  for (int items : { 3, 9 })
+  {
+    Map map;
+    for (int i = 0; i < items; ++i)
+      map[i] = "x";
+
+    for (auto it = map.begin(); it != map.end(); ++it)
+      it->second += std::to_string(it->first);
+
+    for (int i = 0; i < items; ++i)
+      BOOST_CHECK_EQUAL(map.valueOf(i), "x" + std::to_string(i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenInlineOrPromotedMap_WhenCopying_ThenCopiesAreEqualAndIndependent,
+                              Map,
+                              TestedMapTypes)
+{
+  for (int items : { 3, 9 })
+  {
+    Map map;
+    for (int i = 0; i < items; ++i)
+      map[i] = std::to_string(i);
+
+    Map copy(map);
+    BOOST_CHECK(copy == map);
+    copy[1] = "changed";
+    BOOST_CHECK(copy != map);
+    BOOST_CHECK_EQUAL(map.valueOf(1), "1");
+
+    Map moved(std::move(copy));
+    BOOST_CHECK_EQUAL(moved.valueOf(1), "changed");
+    BOOST_CHECK(copy.isEmpty());
+    moved = map;
+    BOOST_CHECK(moved == map);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenInlineTreeMap_WhenIterating_ThenKeysAreSorted)
+{
+  aisdi::SmallTreeMap<int, int, 8> map;
+  for (int key : { 5, 3, 7, 1, 6 })
+    map[key] = key * key;
+
+  std::vector<int> keys;
+  for (const auto& item : map)
+    keys.push_back(item.first);
+  BOOST_CHECK(keys == std::vector<int>({ 1, 3, 5, 6, 7 }));
+  BOOST_CHECK_EQUAL((--map.end())->second, 49);
+}
+
+BOOST_AUTO_TEST_CASE(GivenInlineAndPromotedMapsWithSameItems_WhenComparing_ThenTheyAreEqual)
+{
+  aisdi::SmallHashMap<int, int, 4> promoted;
+  for (int i = 0; i < 6; ++i)
+    promoted[i] = i;
+  promoted.remove(4);
+  promoted.remove(5);
+  aisdi::SmallHashMap<int, int, 4> small = { { 3, 3 }, { 2, 2 }, { 1, 1 }, { 0, 0 } };
+
+  BOOST_CHECK(!promoted.isInline());
+  BOOST_CHECK(small.isInline());
+  BOOST_CHECK(promoted == small);
+  BOOST_CHECK(small == promoted);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenConstIterator_WhenConvertedByMap_ThenItemCanBeWritten,
+                              Map,
+                              TestedMapTypes)
+{
+  static_assert(!std::is_constructible<typename Map::iterator, typename Map::const_iterator>::value,
+                "only a non-const map turns a const_iterator into an iterator");
+  Map map = { { 1, "one" }, { 2, "two" } };
+  map.toIterator(std::as_const(map).find(2))->second = "changed";
+  for (int i = 3; i < 8; ++i)
+    map[i] = std::to_string(i);
+  map.toIterator(std::as_const(map).find(5))->second = "five";
+
+  BOOST_CHECK_EQUAL(map.valueOf(2), "changed");
+  BOOST_CHECK_EQUAL(map.valueOf(5), "five");
+}
+
+struct Direction
+{
+  bool descending = false;
+
+  bool operator()(int a, int b) const
+  {
+    return descending ? b < a : a < b;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenComparatorWithState_WhenPromoting_ThenItOrdersInlineAndLargeItems)
+{
+  aisdi::SmallMap<aisdi::TreeMap<int, int, Direction>, 4> map(Direction{ true });
+  for (int key : { 2, 4, 1, 3 })
+    map[key] = key;
+  BOOST_CHECK(map.isInline());
+  BOOST_CHECK_EQUAL(map.begin()->first, 4);
+  BOOST_CHECK_EQUAL(map.valueOf(1), 1);
+
+  map[5] = 5;
+  map[0] = 0;
+
+  BOOST_CHECK(!map.isInline());
+  std::vector<int> keys;
+  for (const auto& item : map)
+    keys.push_back(item.first);
+  BOOST_CHECK(keys == std::vector<int>({ 5, 4, 3, 2, 1, 0 }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,8 +1,20 @@
 #include <TreeMap.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <cstdint>
+#include <functional>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <map>
+#include <stdexcept>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -186,6 +198,33 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBeginIterator_WhenDecrementing_ThenOperationT
   BOOST_CHECK_THROW(--(map.cbegin()), std::out_of_range);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBeginIteratorOfNonEmptyMap_WhenDecrementing_ThenOperationThrows,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  BOOST_CHECK_THROW(--(map.begin()), std::out_of_range);
+  BOOST_CHECK_THROW(--(map.cbegin()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenWalkingForwardAndBack_ThenItemsAreVisitedInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" }, { 99, "Dave" }, { 30, "Eve" } };
+  map.remove(27);
+  map[28] = "Frank";
+
+  auto it = map.begin();
+  BOOST_CHECK_EQUAL((it++)->first, 13);
+  BOOST_CHECK_EQUAL((it++)->first, 28);
+  BOOST_CHECK_EQUAL((it++)->first, 30);
+  BOOST_CHECK_EQUAL((it--)->first, 42);
+  BOOST_CHECK_EQUAL((it--)->first, 30);
+  BOOST_CHECK_EQUAL(it->first, 28);
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDereferencing_ThenOperationThrows,
                               K,
                               TestedKeyTypes)
@@ -591,6 +630,921 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithSameSizeAndDifferentKeys_WhenComparingThem_ThenTheyAreNotEqual,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const Map<K> other = { { 42, "Alice" }, { 28, "Bob" } };
+
+  BOOST_CHECK(map != other);
+}
+
+//a key type without operator==, ordered ignoring case
+struct Name
+{
+  std::string text;
+};
+
+struct CaseInsensitiveLess
+{
+  bool operator()(const Name& a, const Name& b) const
+  {
+    return std::lexicographical_compare(a.text.begin(), a.text.end(), b.text.begin(), b.text.end(),
+                                        [](char x, char y) { return std::tolower(x) < std::tolower(y); });
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenMapsWithKeysEqualByComparator_WhenComparingThem_ThenTheyAreEqual)
+{
+  using NameMap = aisdi::TreeMap<Name, int, CaseInsensitiveLess>;
+  const NameMap map = { { Name{ "alice" }, 1 }, { Name{ "Bob" }, 2 } };
+  const NameMap other = { { Name{ "ALICE" }, 1 }, { Name{ "bob" }, 2 } };
+  const NameMap different = { { Name{ "alice" }, 1 }, { Name{ "Bobby" }, 2 } };
+
+  BOOST_CHECK(map == other);
+  BOOST_CHECK(map != different);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEqualMaps_WhenMoveAssigning_ThenAllElementsAreMoved,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+
+  other = std::move(map);
+
+  thenMapContainsItems(other, { { 42, "Alice" }, { 27, "Bob" } });
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedRange_WhenBuildingFromSorted_ThenAllItemsAreInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 100; ++i)
+    expected[2 * i] = std::to_string(i);
+
+  Map<K> map = Map<K>::fromSorted(expected.begin(), expected.end());
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin()));
+  map.remove(100);
+  map[101] = "new";
+  expected.erase(100);
+  expected[101] = "new";
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedRange_WhenBuildingFromSorted_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  const std::vector<std::pair<K, std::string>> items = { { 1, "a" }, { 3, "b" }, { 2, "c" } };
+
+  BOOST_CHECK_THROW(Map<K>::fromSorted(items.begin(), items.end()), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenPartiallySortedRange_WhenConstructingFromIt_ThenLastValueOfEachKeyWins,
+                              K,
+                              TestedKeyTypes)
+{
+  const std::vector<std::pair<K, std::string>> items =
+    { { 1, "a" }, { 3, "b" }, { 3, "c" }, { 7, "d" }, { 2, "e" }, { 7, "f" }, { 0, "g" } };
+
+  const Map<K> map(items.begin(), items.end());
+
+  thenMapContainsItems(map, { { 0, "g" }, { 1, "a" }, { 2, "e" }, { 3, "c" }, { 7, "f" } });
+}
+
+// Gives up after a number of comparisons, to fail a constructor half way.
+//counts down a budget of comparisons shared by all the threads sorting with it
+struct ThrowingLess
+{
+  std::atomic<int>* comparisons;
+
+  bool operator()(int a, int b) const
+  {
+    if (--*comparisons < 0)
+      throw std::runtime_error("comparison failed");
+    return a < b;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenThrowingComparator_WhenConstructingFromRange_ThenExceptionIsPassedOnWithoutLeaks)
+{
+  std::vector<std::pair<int, int>> items;
+  for (int i = 0; i < 100; ++i)
+    items.emplace_back(i % 2 == 0 ? i : 100 - i, i);
+
+  for (int comparisons : { 0, 10, 90, 200 })
+  {
+    std::atomic<int> left(comparisons);
+    BOOST_CHECK_THROW((aisdi::TreeMap<int, int, ThrowingLess>(items.begin(), items.end(), ThrowingLess{ &left })),
+                      std::runtime_error);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingComparator_WhenBulkLoadingInParallel_ThenExceptionIsPassedOnWithoutLeaks)
+{
+  std::vector<std::pair<int, int>> items;
+  for (int i = 0; i < 100000; ++i)
+    items.emplace_back((i * 7919) % 100000, i);
+
+  for (int comparisons : { 0, 1000, 200000, 1000000 })
+  {
+    std::atomic<int> left(1);
+    aisdi::TreeMap<int, int, ThrowingLess> map(ThrowingLess{ &left });
+    map[-1] = -1;
+
+    left = comparisons;
+    BOOST_CHECK_THROW(map.insertBulk(items.begin(), items.end(), 4), std::runtime_error);
+    left = 10;
+    BOOST_CHECK_EQUAL(map.valueOf(-1), -1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingComparator_WhenCombiningMapsInParallel_ThenMapIsLeftEmptyWithoutLeaks)
+{
+  using ThrowingMap = aisdi::TreeMap<int, int, ThrowingLess>;
+  const std::vector<std::function<void(ThrowingMap&, ThrowingMap&&)>> operations = {
+    [](ThrowingMap& map, ThrowingMap&& other) { map.merge(std::move(other), 4); },
+    [](ThrowingMap& map, ThrowingMap&& other) { map.intersect(std::move(other), 4); },
+    [](ThrowingMap& map, ThrowingMap&& other) { map.difference(std::move(other), 4); }
+  };
+  for (const auto& operation : operations)
+    for (int comparisons : { 0, 1000, 20000 })
+    {
+      std::atomic<int> left(100000000);
+      ThrowingMap map(ThrowingLess{ &left });
+      ThrowingMap other(ThrowingLess{ &left });
+      for (int i = 0; i < 40000; ++i)
+      {
+        map[2 * i] = i;
+        other[3 * i] = i;
+      }
+
+      left = comparisons;
+      BOOST_CHECK_THROW(operation(map, std::move(other)), std::runtime_error);
+      BOOST_CHECK(map.isEmpty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLargeUnsortedRange_WhenBulkLoading_ThenLastValueOfEachKeyWins,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 60000; ++i)
+  {
+    const K key = (i * 7919) % 45000;
+    items.emplace_back(key, std::to_string(i));
+    expected[key] = std::to_string(i);
+  }
+
+  const Map<K> map = Map<K>::bulkLoad(items.begin(), items.end(), 4);
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin()));
+  auto it = map.end();
+  for (auto expectedIt = expected.rbegin(); expectedIt != expected.rend(); ++expectedIt)
+    BOOST_REQUIRE_EQUAL((--it)->first, expectedIt->first);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenInsertingBulk_ThenItemsAreMergedAsWithOperatorIndex,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+  const std::vector<std::pair<K, std::string>> items =
+    { { 99, "Dave" }, { 27, "Eve" }, { 5, "Frank" }, { 99, "Grace" } };
+
+  map.insertBulk(items.begin(), items.end(), 2);
+  map.remove(13);
+
+  thenMapContainsItems(map, { { 5, "Frank" }, { 27, "Eve" }, { 42, "Alice" }, { 99, "Grace" } });
+  BOOST_CHECK_EQUAL(map.min().first, 5);
+  BOOST_CHECK_EQUAL(map.max().first, 99);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingMinOrMax_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  BOOST_CHECK_THROW(map.min(), std::out_of_range);
+  BOOST_CHECK_THROW(map.max(), std::out_of_range);
+  BOOST_CHECK_THROW(map.popMin(), std::out_of_range);
+  BOOST_CHECK_THROW(map.popMax(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenGettingMinAndMax_ThenBoundaryItemsAreReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" }, { 99, "Dave" } };
+
+  BOOST_CHECK_EQUAL(map.min().first, 13);
+  BOOST_CHECK_EQUAL(map.max().second, "Dave");
+  BOOST_CHECK(map.begin() == map.find(13));
+  BOOST_CHECK(--map.end() == map.find(99));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenPoppingMinAndMax_ThenItemsAreRemovedInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" }, { 99, "Dave" } };
+
+  BOOST_CHECK_EQUAL(map.popMin().second, "Chuck");
+  BOOST_CHECK_EQUAL(map.popMax().second, "Dave");
+  BOOST_CHECK_EQUAL(map.popMin().second, "Bob");
+
+  thenMapContainsItems(map, { { 42, "Alice" } });
+  BOOST_CHECK_EQUAL(map.min().first, 42);
+  BOOST_CHECK_EQUAL(map.max().first, 42);
+  map.popMax();
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingManyItems_ThenRemainingItemsAreIteratedInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 200; ++i)
+  {
+    const K key = (i * 37) % 200;
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+  for (K i = 0; i < 200; i += 3)
+  {
+    const K key = (i * 53) % 200;
+    map.remove(key);
+    expected.erase(key);
+  }
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin()));
+  auto it = map.end();
+  for (auto expectedIt = expected.rbegin(); expectedIt != expected.rend(); ++expectedIt)
+    BOOST_CHECK_EQUAL((--it)->first, expectedIt->first);
+  BOOST_CHECK_EQUAL(map.min().first, expected.begin()->first);
+  BOOST_CHECK_EQUAL(map.max().first, expected.rbegin()->first);
+}
+
+template <typename K>
+void givenTwoOverlappingMaps(Map<K>& first, Map<K>& second,
+                             std::map<K, std::string>& expectedFirst,
+                             std::map<K, std::string>& expectedSecond,
+                             K count)
+{
+  for (K i = 0; i < count; ++i)
+  {
+    const K key = (i * 7919) % count;
+    if (key % 2 == 0)
+    {
+      first[key] = "first" + std::to_string(key);
+      expectedFirst[key] = "first" + std::to_string(key);
+    }
+    if (key % 3 == 0)
+    {
+      second[key] = "second" + std::to_string(key);
+      expectedSecond[key] = "second" + std::to_string(key);
+    }
+  }
+}
+
+template <typename K>
+void thenMapIsIteratedInOrder(const Map<K>& map, const std::map<K, std::string>& expected)
+{
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin()));
+  auto it = map.end();
+  for (auto expectedIt = expected.rbegin(); expectedIt != expected.rend(); ++expectedIt)
+    BOOST_CHECK_EQUAL((--it)->first, expectedIt->first);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenMerging_ThenValuesOfSecondMapWin,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map, other;
+  std::map<K, std::string> expected, expectedOther;
+  givenTwoOverlappingMaps<K>(map, other, expected, expectedOther, 1000);
+
+  map.merge(other);
+
+  for (const auto& item : expectedOther)
+    expected[item.first] = item.second;
+  thenMapIsIteratedInOrder(map, expected);
+  thenMapContainsItems(other, expectedOther);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenIntersecting_ThenCommonKeysKeepValuesOfFirstMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map, other;
+  std::map<K, std::string> expected, expectedOther;
+  givenTwoOverlappingMaps<K>(map, other, expected, expectedOther, 1000);
+
+  map.intersect(other);
+
+  for (auto it = expected.begin(); it != expected.end();)
+    it = expectedOther.count(it->first) == 0 ? expected.erase(it) : std::next(it);
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenSubtracting_ThenKeysOfSecondMapAreRemoved,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map, other;
+  std::map<K, std::string> expected, expectedOther;
+  givenTwoOverlappingMaps<K>(map, other, expected, expectedOther, 1000);
+
+  map.difference(other);
+
+  for (const auto& item : expectedOther)
+    expected.erase(item.first);
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenApplyingSetOperations_ThenResultsMatchSetAlgebra,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> other = { { 1, "Alice" }, { 2, "Bob" } };
+  Map<K> map;
+
+  map.intersect(other);
+  BOOST_CHECK(map.isEmpty());
+  map.difference(other);
+  BOOST_CHECK(map.isEmpty());
+  map.merge(other);
+  BOOST_CHECK(map == other);
+  map.merge(Map<K>());
+  BOOST_CHECK(map == other);
+  map.difference(other);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLargeMaps_WhenApplyingSetOperationsInParallel_ThenResultsMatchSequentialOnes,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map, other;
+  std::map<K, std::string> expected, expectedOther;
+  givenTwoOverlappingMaps<K>(map, other, expected, expectedOther, 90000);
+
+  Map<K> merged(map), intersected(map), subtracted(map);
+  merged.merge(other, 4);
+  intersected.intersect(other, 4);
+  subtracted.difference(other, 4);
+
+  Map<K> mergedSequentially(map), intersectedSequentially(map), subtractedSequentially(map);
+  mergedSequentially.merge(other, 1);
+  intersectedSequentially.intersect(other, 1);
+  subtractedSequentially.difference(other, 1);
+
+  BOOST_CHECK_EQUAL(merged.getSize(), 60000u);
+  BOOST_CHECK_EQUAL(intersected.getSize(), 15000u);
+  BOOST_CHECK_EQUAL(subtracted.getSize(), 30000u);
+  BOOST_CHECK(merged == mergedSequentially);
+  BOOST_CHECK(intersected == intersectedSequentially);
+  BOOST_CHECK(subtracted == subtractedSequentially);
+  BOOST_CHECK_EQUAL(merged.find(6)->second, "second6");
+  BOOST_CHECK_EQUAL(intersected.find(6)->second, "first6");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSplittingAtKey_ThenSmallerKeysGoToFirstPart,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expectedFirst, expectedSecond;
+  for (K i = 0; i < 500; ++i)
+  {
+    const K key = (i * 263) % 500;
+    map[key] = std::to_string(key);
+    (key < 200 ? expectedFirst : expectedSecond)[key] = std::to_string(key);
+  }
+
+  auto parts = map.split(200);
+
+  BOOST_CHECK(map.isEmpty());
+  thenMapIsIteratedInOrder(parts.first, expectedFirst);
+  thenMapIsIteratedInOrder(parts.second, expectedSecond);
+  BOOST_CHECK_EQUAL(parts.second.min().first, 200);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSplittingOutsideOfKeyRange_ThenOnePartIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+  const Map<K> expected(map);
+
+  auto parts = map.split(13);
+  BOOST_CHECK(parts.first.isEmpty());
+  BOOST_CHECK(parts.second == expected);
+
+  parts = parts.second.split(43);
+  BOOST_CHECK(parts.first == expected);
+  BOOST_CHECK(parts.second.isEmpty());
+  BOOST_CHECK(parts.second.begin() == parts.second.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSplitMap_WhenJoiningParts_ThenOriginalMapIsRestored,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 500; ++i)
+  {
+    map[i * 2] = std::to_string(i);
+    expected[i * 2] = std::to_string(i);
+  }
+
+  auto parts = map.split(301);
+  const auto joined = Map<K>::join(std::move(parts.first), std::move(parts.second));
+
+  thenMapIsIteratedInOrder(joined, expected);
+  BOOST_CHECK(parts.first.isEmpty());
+  BOOST_CHECK(parts.second.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsWithOverlappingKeys_WhenJoining_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> left = { { 13, "Chuck" }, { 42, "Alice" } };
+  Map<K> right = { { 42, "Bob" }, { 99, "Dave" } };
+
+  BOOST_CHECK_THROW(Map<K>::join(std::move(left), std::move(right)), std::invalid_argument);
+  thenMapContainsItems(left, { { 13, "Chuck" }, { 42, "Alice" } });
+  thenMapContainsItems(right, { { 42, "Bob" }, { 99, "Dave" } });
+  BOOST_CHECK(Map<K>::join(std::move(left), Map<K>()).getSize() == 2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingByIterator_ThenNextIteratorIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  auto it = map.remove(map.find(27));
+  BOOST_CHECK(it == map.find(42));
+  it = map.remove(it);
+  BOOST_CHECK(it == map.end());
+
+  thenMapContainsItems(map, { { 13, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenErasingIteratorRange_ThenOnlyItemsInRangeAreRemoved,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 300; ++i)
+  {
+    const K key = (i * 77) % 300;
+    map[key] = std::to_string(key);
+    if (key < 100 || key >= 250)
+      expected[key] = std::to_string(key);
+  }
+
+  const auto it = map.erase(map.find(100), map.find(250));
+
+  BOOST_CHECK(it == map.find(250));
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenErasingUpToEnd_ThenEndIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  BOOST_CHECK(map.erase(map.begin(), map.begin()) == map.begin());
+  BOOST_CHECK(map.erase(map.find(27), map.end()) == map.end());
+  thenMapContainsItems(map, { { 13, "Chuck" } });
+  BOOST_CHECK_THROW(map.erase(map.end(), map.begin()), std::out_of_range);
+  BOOST_CHECK(map.erase(map.begin(), map.end()) == map.end());
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenErasingKeyRange_ThenNumberOfRemovedItemsIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 100; ++i)
+  {
+    map[i * 3] = std::to_string(i);
+    if (i * 3 < 31 || i * 3 >= 200)
+      expected[i * 3] = std::to_string(i);
+  }
+
+  BOOST_CHECK_EQUAL(map.eraseRange(31, 200), 56u);
+  thenMapIsIteratedInOrder(map, expected);
+  BOOST_CHECK_EQUAL(map.eraseRange(200, 31), 0u);
+  BOOST_CHECK_EQUAL(map.eraseRange(500, 600), 0u);
+  BOOST_CHECK_EQUAL(map.eraseRange(0, 1000), expected.size());
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIncreasingKeys_WhenInsertingWithEndHint_ThenItemsAreAppended,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 300; ++i)
+  {
+    const auto it = map.insert(map.end(), i, std::to_string(i));
+    BOOST_CHECK_EQUAL(it->first, i);
+    expected[i] = std::to_string(i);
+  }
+
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCorrectHint_WhenEmplacing_ThenItemIsInsertedBeforeHint,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "Alice" }, { 20, "Bob" }, { 30, "Chuck" } };
+
+  auto it = map.emplace_hint(map.find(20), 15, "Dave");
+  BOOST_CHECK(++it == map.find(20));
+  it = map.emplace_hint(map.begin(), 5, "Eve");
+  BOOST_CHECK(it == map.begin());
+  it = map.emplace_hint(it, 7, "Frank");
+  BOOST_CHECK_EQUAL((++it)->first, 10);
+
+  thenMapIsIteratedInOrder(map, { { 5, "Eve" }, { 7, "Frank" }, { 10, "Alice" }, { 15, "Dave" },
+                                  { 20, "Bob" }, { 30, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenWrongHint_WhenInserting_ThenItemIsStillPlacedInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "Alice" }, { 20, "Bob" }, { 30, "Chuck" } };
+
+  map.insert(map.begin(), 25, "Dave");
+  map.insert(map.end(), 1, "Eve");
+  map.insert(map.find(10), 35, "Frank");
+
+  thenMapIsIteratedInOrder(map, { { 1, "Eve" }, { 10, "Alice" }, { 20, "Bob" }, { 25, "Dave" },
+                                  { 30, "Chuck" }, { 35, "Frank" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenExistingKey_WhenInsertingWithHint_ThenItemIsNotChanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "Alice" }, { 20, "Bob" }, { 30, "Chuck" } };
+
+  BOOST_CHECK(map.insert(map.find(20), 20, "Dave") == map.find(20));
+  BOOST_CHECK(map.insert(map.find(30), 20, "Dave") == map.find(20));
+  BOOST_CHECK(map.insert(map.end(), 10, "Dave") == map.find(10));
+
+  thenMapContainsItems(map, { { 10, "Alice" }, { 20, "Bob" }, { 30, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFingerSearch_WhenLookingUpKeys_ThenResultsMatchPlainSearch,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K i = 0; i < 1000; ++i)
+    map[(i * 7919) % 1000 * 2] = std::to_string(i);
+  Map<K> plain(map);
+  map.setFingerSearch(true);
+
+  for (K i = 0; i < 3000; ++i)
+  {
+    const K key = (i * 1237) % 2100;
+    const auto it = map.find(key);
+    const auto expected = plain.find(key);
+    BOOST_REQUIRE_EQUAL(it == map.end(), expected == plain.end());
+    if (it != map.end())
+      BOOST_CHECK_EQUAL(it->second, expected->second);
+  }
+  BOOST_CHECK(map.isFingerSearch());
+  BOOST_CHECK_EQUAL(map.fingerStats().lookups, 3000u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFingerSearch_WhenLookingUpNeighbouringKeys_ThenFewNodesAreVisited,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K i = 0; i < 10000; ++i)
+    map[(i * 7919) % 10000] = std::to_string((i * 7919) % 10000);
+  map.setFingerSearch(true);
+
+  for (K key = 0; key < 10000; ++key)
+    BOOST_REQUIRE_EQUAL(map.valueOf(key), std::to_string(key));
+
+  const auto& stats = map.fingerStats();
+  BOOST_CHECK_EQUAL(stats.lookups, 10000u);
+  BOOST_CHECK_GT(stats.hits, 9000u);
+  BOOST_CHECK_LT(stats.steps, 5 * stats.lookups);
+  map.resetFingerStats();
+  BOOST_CHECK_EQUAL(map.fingerStats().steps, 0u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFingerSearch_WhenRemovingAndSplitting_ThenLookupsStillWork,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "Alice" }, { 20, "Bob" }, { 30, "Chuck" }, { 40, "Dave" } };
+  map.setFingerSearch(true);
+
+  BOOST_CHECK_EQUAL(map.valueOf(20), "Bob");
+  map.remove(20);
+  BOOST_CHECK(map.find(20) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(30), "Chuck");
+  map.popMax();
+  map[15] = "Eve";
+
+  auto parts = map.split(15);
+  BOOST_CHECK(map.find(30) == map.end());
+  map = std::move(parts.second);
+  BOOST_CHECK_EQUAL(map.valueOf(30), "Chuck");
+  BOOST_CHECK_EQUAL(map.valueOf(15), "Eve");
+  BOOST_CHECK(parts.second.find(30) == parts.second.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenReversedComparator_WhenUsingMap_ThenKeysAreKeptInDescendingOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  using ReversedMap = aisdi::TreeMap<K, std::string, std::greater<K>>;
+  ReversedMap map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" }, { 99, "Dave" } };
+  map.remove(27);
+  map.merge(ReversedMap{ { 7, "Eve" }, { 42, "Frank" } });
+
+  std::vector<K> keys;
+  for (const auto& item : map)
+    keys.push_back(item.first);
+  BOOST_CHECK((keys == std::vector<K>{ 99, 42, 13, 7 }));
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Frank");
+  BOOST_CHECK_EQUAL(map.min().first, 99);
+
+  auto parts = map.split(13);
+  BOOST_CHECK_EQUAL(parts.first.getSize(), 2u);
+  BOOST_CHECK_EQUAL(parts.second.max().first, 7);
+  BOOST_CHECK_THROW(ReversedMap::join(std::move(parts.second), std::move(parts.first)),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenLookingUpAndRemoving_ThenItemsAreFound)
+{
+  aisdi::TreeMap<std::string, int> map;
+  for (int i = 0; i < 200; ++i)
+    map["key" + std::to_string((i * 37) % 200)] = (i * 37) % 200;
+
+  BOOST_CHECK_EQUAL(map.valueOf("key150"), 150);
+  BOOST_CHECK(map.find("key") == map.end());
+  BOOST_CHECK(map.find("key1500") == map.end());
+  map.remove("key150");
+  BOOST_CHECK(map.find("key150") == map.end());
+  BOOST_CHECK_EQUAL(map.getSize(), 199u);
+  BOOST_CHECK_EQUAL(map.min().first, "key0");
+}
+
+namespace
+{
+
+// Compares strings with C strings without converting them.
+struct TransparentStringLess
+{
+  using is_transparent = void;
+
+  bool operator()(const std::string& a, const std::string& b) const { return a < b; }
+  bool operator()(const std::string& a, const char* b) const { return a.compare(b) < 0; }
+  bool operator()(const char* a, const std::string& b) const { return b.compare(a) > 0; }
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(GivenTransparentComparator_WhenLookingUpByCString_ThenItemIsFound)
+{
+  aisdi::TreeMap<std::string, int, TransparentStringLess> map = { { "Alice", 1 }, { "Bob", 2 },
+                                                                  { "Chuck", 3 } };
+  const char* bob = "Bob";
+
+  BOOST_CHECK_EQUAL(map.valueOf(bob), 2);
+  BOOST_CHECK(map.find(bob) == map.find(std::string("Bob")));
+  map.setFingerSearch(true);
+  BOOST_CHECK_EQUAL(map.find("Chuck")->second, 3);
+  BOOST_CHECK(map.find("Dave") == map.end());
+  map.remove(bob);
+  BOOST_CHECK(map.find(bob) == map.end());
+  map.remove(map.begin());
+  BOOST_CHECK_EQUAL(map.getSize(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenLookingUpByStringView_ThenItemsAreFound)
+{
+  aisdi::TreeMap<std::string, int> map = { { "Alice", 1 }, { "Bob", 2 }, { "Chuck", 3 } };
+  const std::string buffer = "Bob,Chuck";
+  const std::string_view bob = std::string_view(buffer).substr(0, 3);
+  const std::string_view chuck = std::string_view(buffer).substr(4);
+
+  BOOST_CHECK_EQUAL(map.valueOf(bob), 2);
+  BOOST_CHECK(map.find(chuck) == map.find(std::string("Chuck")));
+  BOOST_CHECK(map.find(std::string_view(buffer)) == map.end());
+  BOOST_CHECK_EQUAL(map.find("Alice")->second, 1);
+  BOOST_CHECK_THROW(map.valueOf("Dave"), std::out_of_range);
+
+  map.remove(bob);
+  BOOST_CHECK(map.find(bob) == map.end());
+  map.remove(map.find("Alice"));
+  BOOST_CHECK_EQUAL(map.getSize(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopiedMap_WhenModifyingEitherMap_ThenTheOtherIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 200; ++i)
+    map[i] = expected[i] = std::to_string(i);
+
+  Map<K> copy(map);
+  Map<K> otherCopy = map;
+  std::map<K, std::string> expectedCopy = expected;
+  std::map<K, std::string> expectedOtherCopy = expected;
+
+  copy[1] = expectedCopy[1] = "one";
+  copy.remove(2);
+  expectedCopy.erase(2);
+  copy.begin()->second = expectedCopy[0] = "first";
+  copy.popMax();
+  expectedCopy.erase(199);
+
+  auto first = otherCopy.cbegin();
+  auto last = first;
+  for (int i = 0; i < 10; ++i)
+    ++last;
+  otherCopy.erase(++first, last);
+  expectedOtherCopy.erase(expectedOtherCopy.find(1), expectedOtherCopy.find(10));
+  otherCopy.insert(otherCopy.cend(), 500, "five hundred");
+  expectedOtherCopy[500] = "five hundred";
+
+  map.eraseRange(50, 100);
+  expected.erase(expected.find(50), expected.find(100));
+
+  thenMapIsIteratedInOrder(map, expected);
+  thenMapIsIteratedInOrder(copy, expectedCopy);
+  thenMapIsIteratedInOrder(otherCopy, expectedOtherCopy);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopyOfDestroyedMap_WhenUsingIt_ThenItemsAreStillThere,
+                              K,
+                              TestedKeyTypes)
+{
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 100; ++i)
+    expected[i] = std::to_string(i);
+  auto map = std::make_unique<Map<K>>(expected.begin(), expected.end());
+  Map<K> copy;
+  copy = *map;
+  Map<K> moved(std::move(*map));
+  map.reset();
+
+  thenMapIsIteratedInOrder(copy, expected);
+  copy.merge(moved);
+  thenMapIsIteratedInOrder(copy, expected);
+  thenMapIsIteratedInOrder(moved, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIteratorTakenBeforeWrite_WhenRemovingThroughIt_ThenCopyIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 10; ++i)
+    expected[i] = std::to_string(i);
+  Map<K> map(expected.begin(), expected.end());
+  const Map<K> copy(map);
+
+  const auto it = std::as_const(map).find(5);
+  map[100] = "hundred";
+  map.remove(it);
+
+  thenMapIsIteratedInOrder(copy, expected);
+  expected.erase(5);
+  expected[100] = "hundred";
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenReferenceTakenBeforeCopy_WhenWritingThroughIt_ThenCopyIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "one" }, { 2, "two" } };
+  std::string& value = map[1];
+  const Map<K> copy(map);
+  Map<K> assigned;
+  assigned = map;
+
+  value = "changed";
+
+  BOOST_CHECK_EQUAL(map.valueOf(1), "changed");
+  BOOST_CHECK_EQUAL(copy.valueOf(1), "one");
+  BOOST_CHECK_EQUAL(assigned.valueOf(1), "one");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenModifyingMapThroughNewHandles_ThenSnapshotIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 20; ++i)
+    expected[i] = std::to_string(i);
+  Map<K> map(expected.begin(), expected.end());
+
+  const Map<K> snapshot = map.snapshot();
+  static_assert(!std::is_constructible<typename Map<K>::iterator, typename Map<K>::const_iterator>::value,
+                "only a non-const map turns a const_iterator into an iterator");
+  const auto converted = map.toIterator(std::as_const(map).find(3));
+  converted->second = "three";
+  const Map<K> otherSnapshot = map.snapshot();
+  const auto empty = map.erase(map.cbegin(), map.cbegin());
+  empty->second = "zero";
+  map.remove(++map.cbegin());
+
+  thenMapIsIteratedInOrder(snapshot, expected);
+  expected[3] = "three";
+  thenMapIsIteratedInOrder(otherSnapshot, expected);
+  expected[0] = "zero";
+  expected.erase(1);
+  thenMapIsIteratedInOrder(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDroppedSnapshots_WhenTakingNewOnes_ThenEachSeesItsOwnVersion)
+{
+  aisdi::TreeMap<int, int> map = { { 1, 1 } };
+  for (int i = 2; i < 6; ++i)
+  {
+    {
+      const auto dropped = map.snapshot();
+    }
+    map[i] = i;
+    const auto kept = map.snapshot();
+    map[i] = -i;
+    BOOST_CHECK_EQUAL(kept.valueOf(i), i);
+    BOOST_CHECK_EQUAL(kept.getSize(), static_cast<std::size_t>(i));
+    BOOST_CHECK_EQUAL(map.valueOf(i), -i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenConstMap_WhenSnapshotsAreTakenByManyThreads_ThenAllShareItsItems)
+{
+  std::map<int, std::string> expected;
+  for (int i = 0; i < 1000; ++i)
+    expected[i] = std::to_string(i);
+  const aisdi::TreeMap<int, std::string> map(expected.begin(), expected.end());
+
+  std::vector<std::thread> readers;
+  std::atomic<int> mismatches(0);
+  for (int t = 0; t < 4; ++t)
+    readers.emplace_back([&] {
+      for (int i = 0; i < 100; ++i)
+      {
+        auto snapshot = map.snapshot();
+        if (snapshot.valueOf(i) != expected.at(i))
+          ++mismatches;
+        snapshot[i] = "changed";
+      }
+    });
+  for (auto& reader : readers)
+    reader.join();
+
+  BOOST_CHECK_EQUAL(mismatches.load(), 0);
+  thenMapIsIteratedInOrder(map, expected);
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 